@@ -6,23 +6,69 @@
 #include <cppmaths/vec.hpp>
 #include <cppmaths/mat.hpp>
 
+#include "bones.hpp"
+
 namespace GL {
 
 class Shader;
 
-template<u32 N, typename Tupl>
+// GLSL type a tuple element is fetched as, 0 when it has no fixed mapping
+template<typename T>
+constexpr u32 glslType = 0;
+template<> constexpr u32 glslType<float> = GL_FLOAT;
+template<> constexpr u32 glslType<RGBA> = GL_FLOAT_VEC4;
+template<> constexpr u32 glslType<RGB> = GL_FLOAT_VEC3;
+template<> constexpr u32 glslType<Vec2> = GL_FLOAT_VEC2;
+template<> constexpr u32 glslType<Vec3> = GL_FLOAT_VEC3;
+template<> constexpr u32 glslType<Mat3> = GL_FLOAT_MAT3;
+template<> constexpr u32 glslType<Mat4> = GL_FLOAT_MAT4;
+template<> constexpr u32 glslType<BoneIndices> = GL_UNSIGNED_INT_VEC4;
+template<> constexpr u32 glslType<BoneWeights> = GL_FLOAT_VEC4;
+
+// SoA linkers read element I from buffers[I] with a tight stride instead of
+// striding over the interleaved Tuple in the currently bound buffer
+template<u32 N, typename Tupl, bool SoA = false>
 class AttribLinker {
     Shader& m_shader;
+    const u32* m_buffers;
 
     using type_N = TupleElementNoerror<N, Tupl>;
 
     template<u32 Advance>
-    using R = Conditional<IsSame<TupleElementNoerror<N+Advance, Tupl>, void>, Shader&, AttribLinker<N+Advance, Tupl>>;
+    using R = Conditional<IsSame<TupleElementNoerror<N+Advance, Tupl>, void>, Shader&, AttribLinker<N+Advance, Tupl, SoA>>;
 
     using next_R = R<1>;
 
+    template<u32 Advance>
+    inline R<Advance> advance() {
+        if constexpr (IsSame<TupleElementNoerror<N+Advance, Tupl>, void>) {
+            return m_shader;
+        } else {
+            return R<Advance>{m_shader, m_buffers};
+        }
+    }
+
+    template<u32 I>
+    inline void bindStream() {
+        if constexpr (SoA) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffers[I]);
+        }
+    }
+
+    template<u32 I>
+    static constexpr u32 attribStart() {
+        if constexpr (SoA) return 0;
+        else return tupleOffset<I, Tupl>();
+    }
+
+    template<u32 I>
+    static constexpr u32 attribStride() {
+        if constexpr (SoA) return sizeof(TupleElement<I, Tupl>);
+        else return sizeof(Tupl);
+    }
+
 public:
-    inline AttribLinker(Shader& shader) : m_shader(shader) {
+    inline AttribLinker(Shader& shader, const u32* buffers = nullptr) : m_shader(shader), m_buffers(buffers) {
 
     }
 
@@ -49,6 +95,19 @@ public:
         glEnableVertexAttribArray(location);
     }
 
+    // Integer fetch: the shader declares uvec4
+    template<IsSame<BoneIndices> T>
+    inline void linkAttribute(u32 location, u32 start, u32 stride) {
+        glVertexAttribIPointer(location, 4, GL_UNSIGNED_BYTE, stride, reinterpret_cast<void*>(start));
+        glEnableVertexAttribArray(location);
+    }
+
+    template<IsSame<BoneWeights> T>
+    inline void linkAttribute(u32 location, u32 start, u32 stride) {
+        glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<void*>(start));
+        glEnableVertexAttribArray(location);
+    }
+
     template<IsSame<Vec3> T>
     inline void linkAttribute(u32 location, u32 start, u32 stride) {
         glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(start));
@@ -61,6 +120,12 @@ public:
         glEnableVertexAttribArray(location);
     }
 
+    template<IsSame<float> T>
+    inline void linkAttribute(u32 location, u32 start, u32 stride) {
+        glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(start));
+        glEnableVertexAttribArray(location);
+    }
+
     template<IsSame<Mat4> T>
     inline void linkAttribute(u32 location, u32 start, u32 stride) {
         glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(start));
@@ -84,7 +149,7 @@ public:
 
     template<IsSame<Mat3> T>
     inline void linkAttribute(u32 location, u32 start, u32 stride) {
-        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, start, reinterpret_cast<void*>(stride));
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(start));
         glVertexAttribPointer(location+1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(start+12));
         glVertexAttribPointer(location+2, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(start+24));
         glEnableVertexAttribArray(location);
@@ -103,15 +168,16 @@ public:
     next_R linkAttribute(const char* name);
     next_R linkInstancedAttribute(const char* name);
     inline next_R skipAttribute() {
-        return m_shader;
+        return advance<1>();
     }
     next_R autoLink();
     next_R autoInstancedLink();
 
     template<typename... Ts>
     inline next_R customLink(Ts&&... args) {
+        bindStream<N>();
         type_N::linkAttributes(*this, forward<Ts>(args)...);
-        return m_shader;
+        return advance<1>();
     }
 
     template<u32 S>
@@ -119,8 +185,9 @@ public:
 
     template<typename... Ts>
     inline next_R customInstancedLink(Ts&&... args) {
+        bindStream<N>();
         type_N::linkInstancedAttributes(*this, forward<Ts>(args)...);
-        return m_shader;
+        return advance<1>();
     }
 
     Shader& autoLinkAll();
@@ -139,44 +206,56 @@ public:
 
 namespace GL {
 
-template<u32 N, typename Tupl>
-inline typename AttribLinker<N, Tupl>::next_R AttribLinker<N, Tupl>::linkAttribute(const char* name) {
-    linkAttribute<type_N>(m_shader.getAttribLocation(name), tupleOffset<N, Tupl>(), sizeof(Tupl));
-    return m_shader;
+template<u32 N, typename Tupl, bool SoA>
+inline typename AttribLinker<N, Tupl, SoA>::next_R AttribLinker<N, Tupl, SoA>::linkAttribute(const char* name) {
+    bindStream<N>();
+    linkAttribute<type_N>(m_shader.getAttribLocation(name), attribStart<N>(), attribStride<N>());
+    return advance<1>();
 }
 
-template<u32 N, typename Tupl>
-inline typename AttribLinker<N, Tupl>::next_R AttribLinker<N, Tupl>::linkInstancedAttribute(const char* name) {
-    linkInstancedAttribute<type_N>(m_shader.getAttribLocation(name), tupleOffset<N, Tupl>(), sizeof(Tupl));
-    return m_shader;
+template<u32 N, typename Tupl, bool SoA>
+inline typename AttribLinker<N, Tupl, SoA>::next_R AttribLinker<N, Tupl, SoA>::linkInstancedAttribute(const char* name) {
+    bindStream<N>();
+    linkInstancedAttribute<type_N>(m_shader.getAttribLocation(name), attribStart<N>(), attribStride<N>());
+    return advance<1>();
 }
 
-template<u32 N, typename Tupl>
-inline typename AttribLinker<N, Tupl>::next_R AttribLinker<N, Tupl>::autoLink() {
-    linkAttribute<type_N>(m_shader.indexToLocation(N), tupleOffset<N, Tupl>(), sizeof(Tupl));
-    return m_shader;
+template<u32 N, typename Tupl, bool SoA>
+inline typename AttribLinker<N, Tupl, SoA>::next_R AttribLinker<N, Tupl, SoA>::autoLink() {
+    bindStream<N>();
+    i32 location = m_shader.template attribLocation<Tupl>(N);
+    if (location >= 0) linkAttribute<type_N>(location, attribStart<N>(), attribStride<N>());
+    return advance<1>();
 }
 
-template<u32 N, typename Tupl>
-inline typename AttribLinker<N, Tupl>::next_R AttribLinker<N, Tupl>::autoInstancedLink() {
-    return linkInstancedAttribute<type_N>(m_shader.indexToLocation(N), tupleOffset<N, Tupl>(), sizeof(Tupl));
+template<u32 N, typename Tupl, bool SoA>
+inline typename AttribLinker<N, Tupl, SoA>::next_R AttribLinker<N, Tupl, SoA>::autoInstancedLink() {
+    bindStream<N>();
+    i32 location = m_shader.template attribLocation<Tupl>(N);
+    if (location >= 0) linkInstancedAttribute<type_N>(location, attribStart<N>(), attribStride<N>());
+    return advance<1>();
 }
 
-template<u32 N, typename Tupl>
+template<u32 N, typename Tupl, bool SoA>
 template<u32 S>
-inline typename AttribLinker<N, Tupl>::template R<S> AttribLinker<N, Tupl>::linkAttributes(const char* const (&n)[S]) {
+inline typename AttribLinker<N, Tupl, SoA>::template R<S> AttribLinker<N, Tupl, SoA>::linkAttributes(const char* const (&n)[S]) {
     constexpr_for(u32 i=0, i<S, i+1, 
         using iT = TupleElement<i+N, Tupl>;
-        linkAttribute<iT>(m_shader.getAttribLocation(n[i]), tupleOffset<i+N, Tupl>(), sizeof(Tupl));
+        bindStream<i+N>();
+        linkAttribute<iT>(m_shader.getAttribLocation(n[i]), attribStart<i+N>(), attribStride<i+N>());
     );
-    return m_shader;
+    return advance<S>();
 }
 
-template<u32 N, typename Tupl>
-inline Shader& AttribLinker<N, Tupl>::autoLinkAll() {
+template<u32 N, typename Tupl, bool SoA>
+inline Shader& AttribLinker<N, Tupl, SoA>::autoLinkAll() {
+    const i32* plan = m_shader.template attribPlan<Tupl>(N);
     constexpr_for(u32 i=N, i<TupleSize<Tupl>, i+1,
         using iT = TupleElement<i, Tupl>;
-        linkAttribute<iT>(m_shader.indexToLocation(i), tupleOffset<i, Tupl>(), sizeof(Tupl));
+        if (plan[i] >= 0) {
+            bindStream<i>();
+            linkAttribute<iT>(plan[i], attribStart<i>(), attribStride<i>());
+        }
     );
     return m_shader;
 }
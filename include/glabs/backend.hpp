@@ -0,0 +1,20 @@
+#pragma once
+#include <glad/glad.h>
+#include <cpputils/debug.hpp>
+
+namespace GL {
+
+// Direct State Access backend (GL 4.5 / ARB_direct_state_access): objects are
+// created with glCreate* and edited by name, without binding. Selected once by
+// load(); the bind-to-modify path stays as the fallback.
+inline bool dsa_enabled {};
+// Immutable storage with persistent mappings (GL 4.4 / ARB_buffer_storage)
+inline bool buffer_storage_enabled {};
+
+inline void selectBackend(bool allow_dsa = true) {
+    dsa_enabled = allow_dsa && (GLAD_GL_VERSION_4_5 || GLAD_GL_ARB_direct_state_access);
+    buffer_storage_enabled = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    logDebug("Backend: %s", dsa_enabled ? "direct state access" : "bind to modify");
+}
+
+};
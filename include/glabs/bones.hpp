@@ -0,0 +1,37 @@
+#pragma once
+#include <cmath>
+#include <cpputils/types.hpp>
+
+namespace GL {
+
+// Skin-weight vertex elements: up to four bones per vertex. Indices are
+// fetched as a uvec4 (glVertexAttribIPointer), weights as a normalized vec4.
+struct BoneIndices {
+    u8 i[4];
+    constexpr BoneIndices(u8 a = 0, u8 b = 0, u8 c = 0, u8 d = 0) : i{a, b, c, d} {}
+};
+
+struct BoneWeights {
+    u8 w[4];
+    constexpr BoneWeights(u8 a = 255, u8 b = 0, u8 c = 0, u8 d = 0) : w{a, b, c, d} {}
+};
+
+// Quantizes four weights so the stored bytes sum to exactly 255; rounding
+// error goes to the largest weight, where it matters least
+constexpr BoneWeights quantizeBoneWeights(float a, float b, float c, float d) {
+    float sum = a + b + c + d;
+    if (sum <= 0.f) return {};
+    float in[4] {a / sum, b / sum, c / sum, d / sum};
+    u8 out[4] {};
+    u32 total {};
+    u32 largest {};
+    for (u32 k {}; k < 4; k++) {
+        out[k] = static_cast<u8>(in[k] * 255.f + 0.5f);
+        total += out[k];
+        if (in[k] > in[largest]) largest = k;
+    }
+    out[largest] = static_cast<u8>(out[largest] + 255 - static_cast<i32>(total));
+    return {out[0], out[1], out[2], out[3]};
+}
+
+};
@@ -1,10 +1,7 @@
 #pragma once
+#include <cmath>
 #include <cpputils/types.hpp>
-
-#ifndef _MATH_H
-extern "C" double fmod(double, double);
-extern "C" double fabs(double);
-#endif
+#include <cppmaths/vec.hpp>
 
 namespace GL {
 
@@ -19,6 +16,10 @@ struct RGB {
     constexpr RGB(u8 r = 0, u8 g = 0, u8 b = 0) : r(r), g(g), b(b) {}
 };
 
+inline Vec4 rgbaToFloat4(RGBA c) {
+    return {c.r/255.f, c.g/255.f, c.b/255.f, c.a/255.f};
+}
+
 constexpr RGBA HexRGBA(u32 num) {
     return RGBA(
         (num & 0xff000000) >> 24u, 
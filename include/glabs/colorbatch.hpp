@@ -0,0 +1,422 @@
+#pragma once
+#include <span>
+#include <cmath>
+#include <algorithm>
+#include <cpputils/types.hpp>
+#include <cppmaths/vec.hpp>
+
+#include "color.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GLABS_COLOR_X86 1
+#endif
+
+namespace GL {
+
+// Batch color conversion kernels. Every SIMD path performs exactly the same
+// float operations as its scalar reference, so results are bit-identical to
+// HSVA() / rgbaToFloat4() / linearToSrgb() applied one element at a time.
+
+enum class SimdLevel : u8 {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+struct ColorKernels {
+    SimdLevel level;
+    void (*hsvaToRGBA)(const float* h, const float* s, const float* v, const float* a, RGBA* out, std::size_t n);
+    void (*rgbaToFloat4)(const RGBA* in, float* out, std::size_t n);
+    void (*float4ToRGBA)(const float* in, RGBA* out, std::size_t n);
+    void (*srgbToLinear)(const RGBA* in, float* out, std::size_t n);
+    void (*linearToSrgb)(const float* in, RGBA* out, std::size_t n);
+};
+
+// Scalar references (rgbaToFloat4(RGBA) lives in color.hpp)
+
+inline u8 unormToU8(float x) {
+    return static_cast<u8>(std::min(std::max(x, 0.f), 1.f) * 255.f + 0.5f);
+}
+
+inline RGBA float4ToRGBA(const Vec4& c) {
+    return RGBA(unormToU8(c.x), unormToU8(c.y), unormToU8(c.z), unormToU8(c.w));
+}
+
+inline float srgbDecode(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float srgbEncode(float l) {
+    return l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+}
+
+namespace detail {
+
+struct SrgbTables {
+    float decode[256];      // sRGB byte -> linear float
+    float threshold[256];   // threshold[k]: smallest linear value that encodes to >= k
+
+    SrgbTables() {
+        for (u32 i {}; i < 256; i++) {
+            decode[i] = srgbDecode(i / 255.f);
+        }
+
+        // The encoded byte is round(255 * srgbEncode(clamp(l))), which is
+        // monotonic in l, so every byte boundary is a single float threshold.
+        auto encodeByte = [](float l) {
+            return static_cast<u32>(srgbEncode(std::min(std::max(l, 0.f), 1.f)) * 255.f + 0.5f);
+        };
+        threshold[0] = -INFINITY;
+        for (u32 k = 1; k < 256; k++) {
+            float lo = 0.f;
+            float hi = 1.f;
+            while (std::nextafter(lo, 1.f) < hi) {
+                float mid = lo + (hi - lo) * 0.5f;
+                if (encodeByte(mid) >= k) hi = mid;
+                else lo = mid;
+            }
+            threshold[k] = hi;
+        }
+    }
+};
+
+inline const SrgbTables& srgbTables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+// Branch-free search over the 255 thresholds: 8 compare-and-add steps
+inline u8 linearToSrgbByte(const float* threshold, float l) {
+    u32 idx {};
+    for (u32 step = 128; step; step >>= 1) {
+        idx += (threshold[idx + step] <= l) ? step : 0;
+    }
+    return static_cast<u8>(idx);
+}
+
+inline void hsvaToRGBAScalar(const float* h, const float* s, const float* v, const float* a, RGBA* out, std::size_t n) {
+    for (std::size_t i {}; i < n; i++) {
+        out[i] = HSVA(h[i], s[i], v[i], a[i]);
+    }
+}
+
+inline void rgbaToFloat4Scalar(const RGBA* in, float* out, std::size_t n) {
+    for (std::size_t i {}; i < n; i++) {
+        Vec4 c = rgbaToFloat4(in[i]);
+        out[i*4+0] = c.x;
+        out[i*4+1] = c.y;
+        out[i*4+2] = c.z;
+        out[i*4+3] = c.w;
+    }
+}
+
+inline void float4ToRGBAScalar(const float* in, RGBA* out, std::size_t n) {
+    for (std::size_t i {}; i < n; i++) {
+        out[i] = RGBA(unormToU8(in[i*4]), unormToU8(in[i*4+1]), unormToU8(in[i*4+2]), unormToU8(in[i*4+3]));
+    }
+}
+
+inline void srgbToLinearScalar(const RGBA* in, float* out, std::size_t n) {
+    const float* decode = srgbTables().decode;
+    for (std::size_t i {}; i < n; i++) {
+        out[i*4+0] = decode[in[i].r];
+        out[i*4+1] = decode[in[i].g];
+        out[i*4+2] = decode[in[i].b];
+        out[i*4+3] = in[i].a/255.f;
+    }
+}
+
+inline void linearToSrgbScalar(const float* in, RGBA* out, std::size_t n) {
+    const float* threshold = srgbTables().threshold;
+    for (std::size_t i {}; i < n; i++) {
+        out[i] = RGBA(
+            linearToSrgbByte(threshold, in[i*4]),
+            linearToSrgbByte(threshold, in[i*4+1]),
+            linearToSrgbByte(threshold, in[i*4+2]),
+            unormToU8(in[i*4+3])
+        );
+    }
+}
+
+#ifdef GLABS_COLOR_X86
+
+// fmod(x, y) for |x/y| < 2^22, exact: the quotient may round up to the next
+// integer, which only flips the sign of the (exactly computed) remainder.
+inline __m128 fmodSSE2(__m128 x, float y) {
+    __m128 vy = _mm_set1_ps(y);
+    __m128 q = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(x, vy)));
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, vy));
+    __m128 zero = _mm_setzero_ps();
+    __m128 fixUp = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(r, zero), _mm_cmpge_ps(x, zero)), vy);
+    __m128 fixDown = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(r, zero), _mm_cmplt_ps(x, zero)), vy);
+    return _mm_sub_ps(_mm_add_ps(r, fixUp), fixDown);
+}
+
+inline __m128 sectorSSE2(__m128i sector, int k) {
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(sector, _mm_set1_epi32(k)));
+}
+
+inline __m128i packRGBA_SSE2(__m128i r, __m128i g, __m128i b, __m128i a) {
+    __m128i mask = _mm_set1_epi32(0xff);
+    return _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(r, mask), _mm_slli_epi32(_mm_and_si128(g, mask), 8)),
+        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(b, mask), 16), _mm_slli_epi32(_mm_and_si128(a, mask), 24))
+    );
+}
+
+inline void hsvaToRGBASSE2(const float* h, const float* s, const float* v, const float* a, RGBA* out, std::size_t n) {
+    const __m128 k255 = _mm_set1_ps(255.f);
+    const __m128 k2 = _mm_set1_ps(2.f);
+    std::size_t i {};
+    for (; i + 4 <= n; i += 4) {
+        __m128 S = _mm_loadu_ps(s + i);
+        __m128 V = _mm_loadu_ps(v + i);
+        __m128 C = _mm_mul_ps(S, V);
+        __m128 HPrime = fmodSSE2(_mm_div_ps(_mm_loadu_ps(h + i), _mm_set1_ps(60.f)), 6.f);
+        __m128 t = fmodSSE2(HPrime, 2.f);
+        __m128 X = _mm_mul_ps(C, _mm_min_ps(t, _mm_sub_ps(k2, t))); // C * (1 - |t - 1|)
+        __m128 M = _mm_sub_ps(V, C);
+
+        __m128i sector = _mm_cvttps_epi32(HPrime);
+        __m128 s0 = sectorSSE2(sector, 0), s1 = sectorSSE2(sector, 1), s2 = sectorSSE2(sector, 2);
+        __m128 s3 = sectorSSE2(sector, 3), s4 = sectorSSE2(sector, 4), s5 = sectorSSE2(sector, 5);
+
+        __m128 R = _mm_or_ps(_mm_and_ps(_mm_or_ps(s0, s5), C), _mm_and_ps(_mm_or_ps(s1, s4), X));
+        __m128 G = _mm_or_ps(_mm_and_ps(_mm_or_ps(s1, s2), C), _mm_and_ps(_mm_or_ps(s0, s3), X));
+        __m128 B = _mm_or_ps(_mm_and_ps(_mm_or_ps(s3, s4), C), _mm_and_ps(_mm_or_ps(s2, s5), X));
+
+        __m128i ri = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(R, M), k255));
+        __m128i gi = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(G, M), k255));
+        __m128i bi = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(B, M), k255));
+        __m128i ai = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(a + i), k255));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packRGBA_SSE2(ri, gi, bi, ai));
+    }
+    hsvaToRGBAScalar(h + i, s + i, v + i, a + i, out + i, n - i);
+}
+
+inline void rgbaToFloat4SSE2(const RGBA* in, float* out, std::size_t n) {
+    const __m128 k255 = _mm_set1_ps(255.f);
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i {};
+    for (; i + 4 <= n; i += 4) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        float* o = out + i*4;
+        _mm_storeu_ps(o,      _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), k255));
+        _mm_storeu_ps(o + 4,  _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), k255));
+        _mm_storeu_ps(o + 8,  _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), k255));
+        _mm_storeu_ps(o + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), k255));
+    }
+    rgbaToFloat4Scalar(in + i, out + i*4, n - i);
+}
+
+inline __m128i unormToU8SSE2(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f)));
+}
+
+inline void float4ToRGBASSE2(const float* in, RGBA* out, std::size_t n) {
+    std::size_t i {};
+    for (; i + 4 <= n; i += 4) {
+        const float* p = in + i*4;
+        // One color per register: narrow the four lanes down to four bytes
+        __m128i c0 = unormToU8SSE2(_mm_loadu_ps(p));
+        __m128i c1 = unormToU8SSE2(_mm_loadu_ps(p + 4));
+        __m128i c2 = unormToU8SSE2(_mm_loadu_ps(p + 8));
+        __m128i c3 = unormToU8SSE2(_mm_loadu_ps(p + 12));
+        __m128i w = _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), w);
+    }
+    float4ToRGBAScalar(in + i*4, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline __m256 fmodAVX2(__m256 x, float y) {
+    __m256 vy = _mm256_set1_ps(y);
+    __m256 q = _mm256_round_ps(_mm256_div_ps(x, vy), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(q, vy));
+    __m256 zero = _mm256_setzero_ps();
+    __m256 fixUp = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(r, zero, _CMP_LT_OQ), _mm256_cmp_ps(x, zero, _CMP_GE_OQ)), vy);
+    __m256 fixDown = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(r, zero, _CMP_GT_OQ), _mm256_cmp_ps(x, zero, _CMP_LT_OQ)), vy);
+    return _mm256_sub_ps(_mm256_add_ps(r, fixUp), fixDown);
+}
+
+__attribute__((target("avx2")))
+inline __m256 sectorAVX2(__m256i sector, int k) {
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(sector, _mm256_set1_epi32(k)));
+}
+
+__attribute__((target("avx2")))
+inline __m256i packRGBA_AVX2(__m256i r, __m256i g, __m256i b, __m256i a) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_and_si256(r, mask), _mm256_slli_epi32(_mm256_and_si256(g, mask), 8)),
+        _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(b, mask), 16), _mm256_slli_epi32(_mm256_and_si256(a, mask), 24))
+    );
+}
+
+__attribute__((target("avx2")))
+inline void hsvaToRGBAAVX2(const float* h, const float* s, const float* v, const float* a, RGBA* out, std::size_t n) {
+    const __m256 k255 = _mm256_set1_ps(255.f);
+    const __m256 k2 = _mm256_set1_ps(2.f);
+    std::size_t i {};
+    for (; i + 8 <= n; i += 8) {
+        __m256 S = _mm256_loadu_ps(s + i);
+        __m256 V = _mm256_loadu_ps(v + i);
+        __m256 C = _mm256_mul_ps(S, V);
+        __m256 HPrime = fmodAVX2(_mm256_div_ps(_mm256_loadu_ps(h + i), _mm256_set1_ps(60.f)), 6.f);
+        __m256 t = fmodAVX2(HPrime, 2.f);
+        __m256 X = _mm256_mul_ps(C, _mm256_min_ps(t, _mm256_sub_ps(k2, t)));
+        __m256 M = _mm256_sub_ps(V, C);
+
+        __m256i sector = _mm256_cvttps_epi32(HPrime);
+        __m256 s0 = sectorAVX2(sector, 0), s1 = sectorAVX2(sector, 1), s2 = sectorAVX2(sector, 2);
+        __m256 s3 = sectorAVX2(sector, 3), s4 = sectorAVX2(sector, 4), s5 = sectorAVX2(sector, 5);
+
+        __m256 R = _mm256_or_ps(_mm256_and_ps(_mm256_or_ps(s0, s5), C), _mm256_and_ps(_mm256_or_ps(s1, s4), X));
+        __m256 G = _mm256_or_ps(_mm256_and_ps(_mm256_or_ps(s1, s2), C), _mm256_and_ps(_mm256_or_ps(s0, s3), X));
+        __m256 B = _mm256_or_ps(_mm256_and_ps(_mm256_or_ps(s3, s4), C), _mm256_and_ps(_mm256_or_ps(s2, s5), X));
+
+        __m256i ri = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(R, M), k255));
+        __m256i gi = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(G, M), k255));
+        __m256i bi = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(B, M), k255));
+        __m256i ai = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(a + i), k255));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packRGBA_AVX2(ri, gi, bi, ai));
+    }
+    hsvaToRGBAScalar(h + i, s + i, v + i, a + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void rgbaToFloat4AVX2(const RGBA* in, float* out, std::size_t n) {
+    const __m256 k255 = _mm256_set1_ps(255.f);
+    std::size_t i {};
+    for (; i + 2 <= n; i += 2) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i*4, _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), k255));
+    }
+    rgbaToFloat4Scalar(in + i, out + i*4, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void srgbToLinearAVX2(const RGBA* in, float* out, std::size_t n) {
+    const float* decode = srgbTables().decode;
+    const __m256 k255 = _mm256_set1_ps(255.f);
+    // Lanes 3 and 7 hold alpha, which is linear already
+    const __m256 alpha = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+    std::size_t i {};
+    for (; i + 2 <= n; i += 2) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+        __m256 lin = _mm256_i32gather_ps(decode, idx, 4);
+        __m256 a = _mm256_div_ps(_mm256_cvtepi32_ps(idx), k255);
+        _mm256_storeu_ps(out + i*4, _mm256_blendv_ps(lin, a, alpha));
+    }
+    srgbToLinearScalar(in + i, out + i*4, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void linearToSrgbAVX2(const float* in, RGBA* out, std::size_t n) {
+    const float* threshold = srgbTables().threshold;
+    const __m256 alpha = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+    std::size_t i {};
+    for (; i + 2 <= n; i += 2) {
+        __m256 l = _mm256_loadu_ps(in + i*4);
+        // The top four steps compare against the 15 thresholds at multiples
+        // of 16 held in registers, so only the last four need gathers
+        __m256i idx = _mm256_setzero_si256();
+        for (u32 k = 16; k < 256; k += 16) {
+            __m256i hit = _mm256_castps_si256(_mm256_cmp_ps(_mm256_set1_ps(threshold[k]), l, _CMP_LE_OQ));
+            idx = _mm256_sub_epi32(idx, hit);
+        }
+        idx = _mm256_slli_epi32(idx, 4);
+        for (int step = 8; step; step >>= 1) {
+            __m256i probe = _mm256_add_epi32(idx, _mm256_set1_epi32(step));
+            __m256 t = _mm256_i32gather_ps(threshold, probe, 4);
+            __m256i hit = _mm256_castps_si256(_mm256_cmp_ps(t, l, _CMP_LE_OQ));
+            idx = _mm256_add_epi32(idx, _mm256_and_si256(hit, _mm256_set1_epi32(step)));
+        }
+        __m256 a = _mm256_min_ps(_mm256_max_ps(l, _mm256_setzero_ps()), _mm256_set1_ps(1.f));
+        __m256i ai = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(a, _mm256_set1_ps(255.f)), _mm256_set1_ps(0.5f)));
+        __m256i c = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(idx), _mm256_castsi256_ps(ai), alpha));
+        // 8 x i32 -> 8 bytes; packs work per 128-bit half, so gather dwords 0 and 4
+        __m256i w = _mm256_packus_epi16(_mm256_packus_epi32(c, c), _mm256_setzero_si256());
+        w = _mm256_permutevar8x32_epi32(w, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(w));
+    }
+    linearToSrgbScalar(in + i*4, out + i, n - i);
+}
+
+#endif
+
+inline ColorKernels selectColorKernels(SimdLevel level) {
+    ColorKernels k {
+        SimdLevel::Scalar,
+        hsvaToRGBAScalar,
+        rgbaToFloat4Scalar,
+        float4ToRGBAScalar,
+        srgbToLinearScalar,
+        linearToSrgbScalar
+    };
+#ifdef GLABS_COLOR_X86
+    if (level >= SimdLevel::SSE2) {
+        k.level = SimdLevel::SSE2;
+        k.hsvaToRGBA = hsvaToRGBASSE2;
+        k.rgbaToFloat4 = rgbaToFloat4SSE2;
+        k.float4ToRGBA = float4ToRGBASSE2;
+    }
+    __builtin_cpu_init();
+    if (level >= SimdLevel::AVX2 && __builtin_cpu_supports("avx2")) {
+        k.level = SimdLevel::AVX2;
+        k.hsvaToRGBA = hsvaToRGBAAVX2;
+        k.rgbaToFloat4 = rgbaToFloat4AVX2;
+        k.srgbToLinear = srgbToLinearAVX2;
+        k.linearToSrgb = linearToSrgbAVX2;
+    }
+#endif
+    return k;
+}
+
+};
+
+// Best kernels for the running CPU, resolved once
+inline const ColorKernels& colorKernels() {
+    static const ColorKernels kernels = detail::selectColorKernels(SimdLevel::AVX2);
+    return kernels;
+}
+
+// Kernels capped at a given level, for comparing paths against each other
+inline ColorKernels colorKernels(SimdLevel level) {
+    return detail::selectColorKernels(level);
+}
+
+// Batch entry points. Each converts out.size() elements; inputs must be at
+// least that long. Float spans are tightly packed RGBA quadruples.
+
+inline void hsvaToRGBA(
+    std::span<const float> h,
+    std::span<const float> s,
+    std::span<const float> v,
+    std::span<const float> a,
+    std::span<RGBA> out
+) {
+    colorKernels().hsvaToRGBA(h.data(), s.data(), v.data(), a.data(), out.data(), out.size());
+}
+
+inline void rgbaToFloat4(std::span<const RGBA> in, std::span<Vec4> out) {
+    colorKernels().rgbaToFloat4(in.data(), reinterpret_cast<float*>(out.data()), out.size());
+}
+
+inline void float4ToRGBA(std::span<const Vec4> in, std::span<RGBA> out) {
+    colorKernels().float4ToRGBA(reinterpret_cast<const float*>(in.data()), out.data(), out.size());
+}
+
+inline void srgbToLinear(std::span<const RGBA> in, std::span<Vec4> out) {
+    colorKernels().srgbToLinear(in.data(), reinterpret_cast<float*>(out.data()), out.size());
+}
+
+inline void linearToSrgb(std::span<const Vec4> in, std::span<RGBA> out) {
+    colorKernels().linearToSrgb(reinterpret_cast<const float*>(in.data()), out.data(), out.size());
+}
+
+};
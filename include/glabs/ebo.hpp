@@ -1,36 +1,68 @@
 #pragma once
 #include <initializer_list>
+#include <span>
+#include <utility>
 #include <glad/glad.h>
 #include <cpputils/types.hpp>
 
+#include "registry.hpp"
+#include "memory.hpp"
+
 namespace GL {
 
 struct EBO {
     u32 vbo;
+
+    inline void storage(u64 size, const void* data, u32 draw_type) {
+        if (dsa_enabled) glNamedBufferData(vbo, size, data, draw_type);
+        else glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, draw_type);
+        trackMemory(ResourceKind::Buffer, vbo, MemoryCategory::Index, size);
+    }
     
     EBO();
+
+    // Owns its name: moves hand it over, copies would delete it twice
+    EBO(const EBO&) = delete;
+    EBO& operator=(const EBO&) = delete;
+
+    inline EBO(EBO&& other) : vbo(std::exchange(other.vbo, 0)) {
+
+    }
+
+    inline EBO& operator=(EBO&& other) {
+        std::swap(vbo, other.vbo);
+        return *this;
+    }
+
     void use();
     void unuse();
 
     inline ~EBO() {
-        glDeleteBuffers(1, &vbo);
+        if (!vbo) return;
+        untrackMemory(ResourceKind::Buffer, vbo);
+        deleteName(ResourceKind::Buffer, vbo);
     }
 
     inline void bufferDataStatic(std::initializer_list<u32> l) {
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, l.size() * sizeof(u32), l.begin(), GL_STATIC_DRAW);
+        storage(l.size() * sizeof(u32), l.begin(), GL_STATIC_DRAW);
     }
 
     inline void bufferDataDynamic(std::initializer_list<u32> l) {
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, l.size() * sizeof(u32), l.begin(), GL_DYNAMIC_DRAW);
+        storage(l.size() * sizeof(u32), l.begin(), GL_DYNAMIC_DRAW);
+    }
+
+    inline void bufferData(std::span<const u32> data, u32 draw_type) {
+        storage(data.size() * sizeof(u32), data.data(), draw_type);
     }
 };
 
 inline EBO::EBO() {
-    glGenBuffers(1, &vbo);
+    vbo = genName(ResourceKind::Buffer);
 }
 
 inline void EBO::use() {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo);
+    touchMemory(ResourceKind::Buffer, vbo);
 }
 
 inline void EBO::unuse() {
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/error.hpp>
+
+#include "workers.hpp"
+
+namespace GL {
+
+// Creates `count` contexts sharing objects with `share` and wraps them in a
+// ContextWorkers pool. Contexts are made current without a surface
+// (EGL_KHR_surfaceless_context), falling back to a 1x1 pbuffer, which needs
+// the render context's config. contextAttribs must match the render context
+// (version, profile).
+inline std::unique_ptr<ContextWorkers> createEGLWorkers(
+    EGLDisplay display,
+    EGLContext share,
+    u32 count,
+    const EGLint* contextAttribs = nullptr
+) {
+    static const EGLint defaultAttribs[] {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    if (!contextAttribs) contextAttribs = defaultAttribs;
+
+    // The API is per thread, and the caller may have bound another one
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        abort("Binding the EGL OpenGL API");
+    }
+
+    EGLint configId {};
+    eglQueryContext(display, share, EGL_CONFIG_ID, &configId);
+    const EGLint configAttribs[] {EGL_CONFIG_ID, configId, EGL_NONE};
+    EGLConfig config {};
+    EGLint configs {};
+    if (configId) eglChooseConfig(display, configAttribs, &config, 1, &configs);
+
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    bool surfaceless = extensions && std::strstr(extensions, "EGL_KHR_surfaceless_context");
+    // A context without a config (EGL_KHR_no_config_context) can only be
+    // made current without a surface
+    if (!configs && !surfaceless) {
+        abort("Shared EGL contexts need the render context's config for their pbuffer");
+    }
+
+    std::vector<SharedContext> contexts;
+    for (u32 i {}; i < count; i++) {
+        EGLContext context = eglCreateContext(display, configs ? config : EGL_NO_CONFIG_KHR, share, contextAttribs);
+        if (context == EGL_NO_CONTEXT) {
+            abort("Creating shared EGL context");
+        }
+
+        EGLSurface surface = EGL_NO_SURFACE;
+        if (!surfaceless) {
+            const EGLint pbufferAttribs[] {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+            if (surface == EGL_NO_SURFACE) {
+                abort("Creating pbuffer for a shared EGL context");
+            }
+        }
+
+        contexts.push_back({
+            [=] {
+                eglBindAPI(EGL_OPENGL_API);
+                return eglMakeCurrent(display, surface, surface, context) == EGL_TRUE;
+            },
+            [=] {
+                eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+                if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+                eglDestroyContext(display, context);
+            }
+        });
+    }
+    logDebug("Created %d shared EGL worker contexts", count);
+    return std::make_unique<ContextWorkers>(std::move(contexts));
+}
+
+};
@@ -1,22 +1,43 @@
 #pragma once
+#include <utility>
 #include <glad/glad.h>
 #include <cpputils/types.hpp>
 #include <cpputils/debug.hpp>
 
+#include "registry.hpp"
+
 class FBO {
     u32 m_id;
     
 public:
     FBO();
     FBO(u32 id);
+
+    // Owns its name: moves hand it over, copies would delete it twice
+    FBO(const FBO&) = delete;
+    FBO& operator=(const FBO&) = delete;
+
+    inline FBO(FBO&& other) : m_id(std::exchange(other.m_id, 0)) {
+
+    }
+
+    inline FBO& operator=(FBO&& other) {
+        std::swap(m_id, other.m_id);
+        return *this;
+    }
+
     FBO& use();
     FBO& unuse();
+    // Attaches a level of a 2D texture, e.g. GL_COLOR_ATTACHMENT0
+    FBO& texture(u32 attachment, u32 texture, i32 level = 0);
+    u32 status();
+    u32 id() const;
     ~FBO();
 };
 
 
 inline FBO::FBO() {
-    glGenFramebuffers(1, &m_id);
+    m_id = GL::genName(GL::ResourceKind::Framebuffer);
     logDebug("Created fbo: %d", m_id);
 }
 
@@ -30,7 +51,28 @@ inline FBO& FBO::unuse() {
     return *this;
 }
 
+inline FBO& FBO::texture(u32 attachment, u32 texture, i32 level) {
+    if (GL::dsa_enabled) {
+        glNamedFramebufferTexture(m_id, attachment, texture, level);
+        return *this;
+    }
+    use();
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, level);
+    return *this;
+}
+
+inline u32 FBO::status() {
+    if (GL::dsa_enabled) return glCheckNamedFramebufferStatus(m_id, GL_FRAMEBUFFER);
+    use();
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER);
+}
+
+inline u32 FBO::id() const {
+    return m_id;
+}
+
 inline FBO::~FBO() {
-    glDeleteFramebuffers(1, &m_id);
+    if (!m_id) return;
+    GL::deleteName(GL::ResourceKind::Framebuffer, m_id);
     logDebug("Destroyed fbo: %d", m_id);
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+#pragma once
+#include <span>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+
+#include "backend.hpp"
+#include "registry.hpp"
+#include "memory.hpp"
+
+namespace GL {
+
+// A slice of a TransientBuffer. data is where the CPU writes, valid until the
+// frame ends; buffer/offset are what draws and glBindBufferRange take.
+struct TransientAllocation {
+    void* data {};
+    u32 buffer {};
+    u32 offset {};
+    u32 size {};
+
+    explicit operator bool() const {
+        return data != nullptr;
+    }
+};
+
+// One GL buffer split in a region per frame in flight, handed out with a
+// linear allocator. A region is only reset once the FrameScheduler has seen
+// the fence of the frame that last used it, so writes never race the GPU.
+// Uses a persistent coherent mapping when buffer storage is available, else
+// a host staging copy uploaded through an unsynchronized mapping. Staged
+// writes only reach the GPU on flush(), so the order per batch is: allocate
+// and write, then flush() (use() and bindRange() do it too), then draw.
+// Each flush uploads just what was allocated since the previous one.
+class TransientBuffer {
+    u32 m_id {};
+    u32 m_target;
+    MemoryCategory m_category;
+    u32 m_capacity;     // Per frame, in bytes
+    u32 m_frames;
+    u32 m_alignment;
+    u8* m_mapped {};
+    std::vector<u8> m_staging;
+    u32 m_base {};      // Start of the current frame's region
+    u32 m_head {};      // Bytes used in the current frame
+    u32 m_flushed {};   // Bytes of the current frame already uploaded
+    u32 m_peak {};
+    u32 m_overflows {};
+
+    static constexpr u32 alignUp(u32 value, u32 alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static constexpr u32 targetOf(MemoryCategory category) {
+        switch (category) {
+        case MemoryCategory::Index:   return GL_ELEMENT_ARRAY_BUFFER;
+        case MemoryCategory::Uniform: return GL_UNIFORM_BUFFER;
+        default:                      return GL_ARRAY_BUFFER;
+        }
+    }
+
+public:
+    inline TransientBuffer(MemoryCategory category, u32 capacity, u32 frames)
+        : m_target(targetOf(category)), m_category(category), m_frames(frames), m_alignment(16) {
+        if (category == MemoryCategory::Uniform) {
+            GLint alignment {};
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            m_alignment = std::max<u32>(m_alignment, alignment);
+        }
+        m_capacity = alignUp(capacity, m_alignment);
+        if (!m_capacity) return;
+
+        u64 size = u64(m_capacity) * m_frames;
+        m_id = genName(ResourceKind::Buffer);
+        // Bound to the copy target so the VAO's element binding is left alone
+        if (buffer_storage_enabled) {
+            const u32 flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            if (dsa_enabled) {
+                glNamedBufferStorage(m_id, size, nullptr, flags);
+                m_mapped = static_cast<u8*>(glMapNamedBufferRange(m_id, 0, size, flags));
+            } else {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+                glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+                m_mapped = static_cast<u8*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+            }
+        } else if (dsa_enabled) {
+            glNamedBufferData(m_id, size, nullptr, GL_STREAM_DRAW);
+        } else {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+            glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+        if (!m_mapped) m_staging.resize(m_capacity);
+        trackMemory(ResourceKind::Buffer, m_id, m_category, size);
+        logDebug("Created transient buffer %d: %d frames of %d bytes (%s)", m_id, m_frames, m_capacity, m_mapped ? "persistent" : "staged");
+    }
+
+    TransientBuffer(const TransientBuffer&) = delete;
+    TransientBuffer& operator=(const TransientBuffer&) = delete;
+
+    // Starts writing the region of frame `frame`; the caller guarantees the
+    // GPU is done with it
+    inline void begin(u32 frame) {
+        m_base = frame * m_capacity;
+        m_head = 0;
+        m_flushed = 0;
+    }
+
+    // Returns an empty allocation when the frame's region is full
+    inline TransientAllocation allocate(u32 bytes, u32 alignment = 0) {
+        u32 offset = alignUp(m_head, std::max(alignment, m_alignment));
+        if (!bytes || offset + bytes > m_capacity) {
+            if (bytes) {
+                m_overflows++;
+                logDebug("Transient buffer %d: %d bytes do not fit in the frame", m_id, bytes);
+            }
+            return {};
+        }
+        m_head = offset + bytes;
+        u8* data = m_mapped ? m_mapped + m_base + offset : m_staging.data() + offset;
+        return {data, m_id, m_base + offset, bytes};
+    }
+
+    template<typename T>
+    inline TransientAllocation push(std::span<const T> values, u32 alignment = 0) {
+        auto a = allocate(values.size_bytes(), std::max<u32>(alignment, alignof(T)));
+        if (a) std::memcpy(a.data, values.data(), values.size_bytes());
+        return a;
+    }
+
+    // Makes the writes since the last flush visible to the GPU; call before
+    // the draws that read them
+    inline void flush() {
+        m_peak = std::max(m_peak, m_head);
+        if (m_mapped || m_flushed == m_head) return;
+        u32 offset = m_base + m_flushed;
+        u32 size = m_head - m_flushed;
+        const u8* src = m_staging.data() + m_flushed;
+        m_flushed = m_head;
+        // The fence guarantees the region is idle and earlier draws this frame
+        // read other bytes, so the driver needn't sync
+        const u32 access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        void* dst;
+        if (dsa_enabled) {
+            dst = glMapNamedBufferRange(m_id, offset, size, access);
+        } else {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+            dst = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, access);
+        }
+        if (dst) {
+            std::memcpy(dst, src, size);
+            if (dsa_enabled) glUnmapNamedBuffer(m_id);
+            else glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            return;
+        }
+        logDebug("glMapBufferRange failed, falling back to bufferSubData");
+        if (dsa_enabled) glNamedBufferSubData(m_id, offset, size, src);
+        else glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, src);
+    }
+
+    inline auto& use() {
+        flush();
+        glBindBuffer(m_target, m_id);
+        touchMemory(ResourceKind::Buffer, m_id);
+        return *this;
+    }
+
+    // Binds an allocation to an indexed uniform block binding
+    inline auto& bindRange(u32 index, const TransientAllocation& a) {
+        flush();
+        glBindBufferRange(m_target, index, m_id, a.offset, a.size);
+        return *this;
+    }
+
+    inline u32 id() const { return m_id; }
+    inline u32 capacity() const { return m_capacity; }
+    inline u32 used() const { return m_head; }
+    inline u32 peak() const { return m_peak; }
+    inline u32 overflows() const { return m_overflows; }
+    inline bool persistent() const { return m_mapped != nullptr; }
+
+    inline ~TransientBuffer() {
+        if (!m_id) return;
+        if (m_mapped) {
+            if (dsa_enabled) {
+                glUnmapNamedBuffer(m_id);
+            } else {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            }
+        }
+        untrackMemory(ResourceKind::Buffer, m_id);
+        deleteName(ResourceKind::Buffer, m_id);
+        logDebug("Destroyed transient buffer %d", m_id);
+    }
+};
+
+struct FrameStats {
+    u64 frames {};
+    u32 stalls {};          // beginFrame calls that had to block on a fence
+    u64 lastWaitNs {};
+    u64 maxWaitNs {};
+    u64 totalWaitNs {};
+};
+
+// Keeps up to `frames` frames queued on the GPU. beginFrame blocks until the
+// oldest one has retired, then hands out its transient regions again. Without
+// buffer storage the regions are staged: call flush() between writing
+// allocations and the draws that read them. endFrame uploads any remainder,
+// fences the frame and lets the memory tracker evict if it went over budget.
+// More frames hide more GPU latency at the cost of input lag and memory;
+// stats() shows how long the CPU waits.
+class FrameScheduler {
+    u32 m_frames;
+    u32 m_current {};
+    std::vector<GLsync> m_fences;
+    TransientBuffer m_vertices;
+    TransientBuffer m_indices;
+    TransientBuffer m_uniforms;
+    FrameStats m_stats;
+
+    static inline bool signaled(GLenum status) {
+        return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    }
+
+    inline void wait(GLsync& fence) {
+        m_stats.lastWaitNs = 0;
+        if (!fence) return;
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (!signaled(status)) {
+            m_stats.stalls++;
+            auto start = std::chrono::steady_clock::now();
+            do {
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+            } while (status == GL_TIMEOUT_EXPIRED);
+            if (status == GL_WAIT_FAILED) logDebug("glClientWaitSync failed");
+            u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            m_stats.lastWaitNs = ns;
+            m_stats.totalWaitNs += ns;
+            m_stats.maxWaitNs = std::max(m_stats.maxWaitNs, ns);
+        }
+        glDeleteSync(fence);
+        fence = {};
+    }
+
+public:
+    // Capacities are per frame, in bytes; 0 leaves that allocator out
+    inline FrameScheduler(u32 frames = 3, u32 vertexBytes = 4 << 20, u32 indexBytes = 1 << 20, u32 uniformBytes = 1 << 20)
+        : m_frames(std::max(frames, 1u)), m_fences(m_frames),
+          m_vertices(MemoryCategory::Vertex, vertexBytes, m_frames),
+          m_indices(MemoryCategory::Index, indexBytes, m_frames),
+          m_uniforms(MemoryCategory::Uniform, uniformBytes, m_frames) {
+        beginFrame();
+    }
+
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    // Called once by the constructor and then after every endFrame
+    inline void beginFrame() {
+        wait(m_fences[m_current]);
+        m_vertices.begin(m_current);
+        m_indices.begin(m_current);
+        m_uniforms.begin(m_current);
+    }
+
+    // Uploads every allocator's staged writes; call before the draws that
+    // read them. A no-op with persistent mappings.
+    inline void flush() {
+        m_vertices.flush();
+        m_indices.flush();
+        m_uniforms.flush();
+    }
+
+    // Call after the frame's last draw; starts the next frame
+    inline void endFrame() {
+        flush();
+        m_fences[m_current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // Between frames no upload is in progress, so evictors can bind freely
+        if (memory_tracker) memory_tracker->enforce();
+        m_current = (m_current + 1) % m_frames;
+        m_stats.frames++;
+        beginFrame();
+    }
+
+    inline TransientBuffer& vertices() { return m_vertices; }
+    inline TransientBuffer& indices() { return m_indices; }
+    inline TransientBuffer& uniforms() { return m_uniforms; }
+
+    inline u32 frames() const { return m_frames; }
+    inline u32 frameIndex() const { return m_current; }
+
+    inline const FrameStats& stats() const {
+        return m_stats;
+    }
+
+    inline void resetStats() {
+        m_stats = {};
+    }
+
+    // Blocks until every queued frame has retired, e.g. before resizing
+    inline void drain() {
+        for (auto& fence : m_fences) wait(fence);
+    }
+
+    inline ~FrameScheduler() {
+        for (auto& fence : m_fences) {
+            if (fence) glDeleteSync(fence);
+        }
+    }
+};
+
+};
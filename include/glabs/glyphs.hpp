@@ -0,0 +1,501 @@
+#pragma once
+#include <span>
+#include <mutex>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <condition_variable>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cppmaths/vec.hpp>
+#include <cppmaths/mat.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GLABS_SDF_SSE2 1
+#endif
+
+#include "color.hpp"
+#include "backend.hpp"
+#include "texture.hpp"
+#include "threadpool.hpp"
+#include "vbo.hpp"
+#include "vao.hpp"
+#include "shader.hpp"
+#include "gl.hpp"
+
+namespace GL {
+
+// Coverage of one glyph rasterized at the source's size, row 0 at the top
+struct GlyphBitmap {
+    u32 width {};
+    u32 height {};
+    i32 left {};        // Pen to the bitmap's left edge
+    i32 top {};         // Baseline to the bitmap's top edge, up is positive
+    float advance {};
+    std::vector<u8> coverage;
+};
+
+// Rasterizes a codepoint, e.g. with FreeType; called from pool threads, so it
+// must be thread safe. Returns false for codepoints the font lacks.
+using GlyphSource = std::function<bool(u32 codepoint, u32 pixelSize, GlyphBitmap& out)>;
+
+namespace detail {
+
+constexpr float sdfInf = 1e20f;
+
+// Felzenszwalb-Huttenlocher squared distance transform of n samples
+inline void edt1d(const float* f, float* d, i32* v, float* z, u32 n) {
+    u32 k {};
+    v[0] = 0;
+    z[0] = -sdfInf;
+    z[1] = sdfInf;
+    for (u32 q = 1; q < n; q++) {
+        float s;
+        for (;;) {
+            i32 r = v[k];
+            s = ((f[q] + float(q) * q) - (f[r] + float(r) * r)) / (2.f * q - 2.f * r);
+            if (s > z[k] || k == 0) break;
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = sdfInf;
+    }
+    k = 0;
+    for (u32 q {}; q < n; q++) {
+        while (z[k + 1] < q) k++;
+        float dq = float(q) - v[k];
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+struct EdtScratch {
+    std::vector<float> f, d, z;
+    std::vector<i32> v;
+
+    inline void reserve(u32 n) {
+        if (f.size() >= n) return;
+        f.resize(n);
+        d.resize(n);
+        z.resize(n + 1);
+        v.resize(n);
+    }
+};
+
+// Squared distances over a w*h grid: columns, then rows
+inline void edt2d(float* grid, u32 w, u32 h, EdtScratch& s) {
+    s.reserve(std::max(w, h));
+    for (u32 x {}; x < w; x++) {
+        for (u32 y {}; y < h; y++) s.f[y] = grid[y * w + x];
+        edt1d(s.f.data(), s.d.data(), s.v.data(), s.z.data(), h);
+        for (u32 y {}; y < h; y++) grid[y * w + x] = s.d[y];
+    }
+    for (u32 y {}; y < h; y++) {
+        float* row = grid + y * w;
+        std::copy(row, row + w, s.f.data());
+        edt1d(s.f.data(), row, s.v.data(), s.z.data(), w);
+    }
+}
+
+// 127.5 - (sqrt(outside) - sqrt(inside)) * scale, clamped to a byte: the
+// edge lands on 0.5, inside is brighter
+inline void encodeSdf(const float* outside, const float* inside, u8* out, u32 n, float scale) {
+    u32 i {};
+#ifdef GLABS_SDF_SSE2
+    const __m128 mid = _mm_set1_ps(127.5f);
+    const __m128 k = _mm_set1_ps(scale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max = _mm_set1_ps(255.f);
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_sub_ps(_mm_sqrt_ps(_mm_loadu_ps(outside + i)), _mm_sqrt_ps(_mm_loadu_ps(inside + i)));
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_sub_ps(mid, _mm_mul_ps(d, k)), zero), max);
+        __m128i q = _mm_cvtps_epi32(v);
+        q = _mm_packs_epi32(q, q);
+        q = _mm_packus_epi16(q, q);
+        i32 packed = _mm_cvtsi128_si32(q);
+        std::memcpy(out + i, &packed, 4);
+    }
+#endif
+    for (; i < n; i++) {
+        float d = std::sqrt(outside[i]) - std::sqrt(inside[i]);
+        out[i] = static_cast<u8>(std::nearbyint(std::clamp(127.5f - d * scale, 0.f, 255.f)));
+    }
+}
+
+}
+
+// Signed distance field of a coverage bitmap, padded by `spread` pixels on
+// each side. Partial coverage places the edge inside the pixel.
+inline std::vector<u8> generateSdf(const GlyphBitmap& glyph, u32 spread, detail::EdtScratch& scratch) {
+    u32 w = glyph.width + 2 * spread;
+    u32 h = glyph.height + 2 * spread;
+    std::vector<float> outside(w * h, detail::sdfInf);
+    std::vector<float> inside(w * h, 0.f);
+    for (u32 y {}; y < glyph.height; y++) {
+        for (u32 x {}; x < glyph.width; x++) {
+            float a = glyph.coverage[y * glyph.width + x] / 255.f;
+            if (a <= 0.f) continue;
+            u32 i = (y + spread) * w + x + spread;
+            if (a >= 1.f) {
+                outside[i] = 0.f;
+                inside[i] = detail::sdfInf;
+            } else {
+                float o = std::max(0.f, 0.5f - a);
+                float n = std::max(0.f, a - 0.5f);
+                outside[i] = o * o;
+                inside[i] = n * n;
+            }
+        }
+    }
+    detail::edt2d(outside.data(), w, h, scratch);
+    detail::edt2d(inside.data(), w, h, scratch);
+    std::vector<u8> sdf(w * h);
+    detail::encodeSdf(outside.data(), inside.data(), sdf.data(), w * h, 127.5f / spread);
+    return sdf;
+}
+
+// Shelf packing: rectangles go on the lowest-fitting row of similar height,
+// a new row opens below the last one when none fits
+class ShelfPacker {
+    struct Shelf {
+        u32 y;
+        u32 height;
+        u32 x;
+    };
+
+    u32 m_width;
+    u32 m_height;
+    u32 m_bottom {};
+    u64 m_used {};
+    std::vector<Shelf> m_shelves;
+
+public:
+    inline ShelfPacker(u32 width, u32 height) : m_width(width), m_height(height) {
+
+    }
+
+    inline bool insert(u32 w, u32 h, u32& x, u32& y) {
+        Shelf* best {};
+        for (auto& s : m_shelves) {
+            // Glyphs much shorter than a shelf would waste most of it
+            if (h > s.height || h * 4 < s.height * 3 || s.x + w > m_width) continue;
+            if (!best || s.height < best->height) best = &s;
+        }
+        if (!best) {
+            if (w > m_width || m_bottom + h > m_height) return false;
+            best = &m_shelves.emplace_back(Shelf{m_bottom, h, 0});
+            m_bottom += h;
+        }
+        x = best->x;
+        y = best->y;
+        best->x += w;
+        m_used += u64(w) * h;
+        return true;
+    }
+
+    inline float occupancy() const {
+        return float(m_used) / (u64(m_width) * m_height);
+    }
+};
+
+// Atlas rectangle and metrics of one glyph. Metrics are in ems (multiply by
+// the pixel size) and include the distance field padding.
+struct GlyphEntry {
+    u32 x {}, y {}, width {}, height {};
+    float left {}, top {}, quadWidth {}, quadHeight {};
+    float advance {};
+};
+
+// Screen rectangle (x, y, w, h), atlas rectangle (u, v, w, h) and color
+struct GlyphQuad {
+    Vec4 rect;
+    Vec4 uv;
+    RGBA color;
+};
+
+struct GlyphStats {
+    u64 generated {};
+    u64 generateNs {};      // Summed over worker threads
+    u64 uploadedBytes {};
+    u64 frameUploadBytes {};    // During the last update()
+    u32 frameUploads {};
+    u32 missing {};         // Codepoints the source could not rasterize
+    u32 rejected {};        // Glyphs that did not fit in the atlas
+};
+
+// Distance field glyph cache: each glyph is rasterized once at `rasterSize`,
+// turned into an SDF on the pool and packed into a shared R8 atlas, from
+// which text of any size is drawn as instanced quads. request() and layout()
+// queue missing glyphs; update() packs and uploads the finished ones and is
+// the only place the atlas changes. Single-channel SDFs round sharp corners
+// at large magnification.
+class GlyphAtlas {
+    struct Generated {
+        u32 codepoint;
+        bool ok;
+        GlyphBitmap metrics;    // coverage left empty
+        std::vector<u8> sdf;
+    };
+
+    GlyphSource m_source;
+    ThreadPool* m_pool;
+    u32 m_rasterSize;
+    u32 m_spread;
+    u32 m_width;
+    u32 m_height;
+    Texture<GL_TEXTURE_2D> m_texture;
+    ShelfPacker m_packer;
+    std::unordered_map<u32, GlyphEntry> m_glyphs;
+    std::unordered_map<u32, bool> m_requested;
+
+    std::mutex m_mutex;
+    std::condition_variable m_idle;
+    std::vector<Generated> m_done;
+    u32 m_inFlight {};
+    std::atomic<u64> m_generated {};
+    std::atomic<u64> m_generateNs {};
+
+    VBO<GlyphQuad> m_quads;
+    VAO m_vao;
+    GlyphStats m_stats;
+
+    inline Generated generate(u32 codepoint) {
+        thread_local detail::EdtScratch scratch;
+        auto start = std::chrono::steady_clock::now();
+        Generated g {codepoint, false, {}, {}};
+        GlyphBitmap bitmap;
+        if (m_source(codepoint, m_rasterSize, bitmap) && bitmap.coverage.size() >= u64(bitmap.width) * bitmap.height) {
+            g.ok = true;
+            if (bitmap.width && bitmap.height) g.sdf = generateSdf(bitmap, m_spread, scratch);
+            bitmap.coverage.clear();
+            g.metrics = std::move(bitmap);
+        }
+        m_generated++;
+        m_generateNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return g;
+    }
+
+    inline void submit(std::vector<u32> batch) {
+        auto job = [this, batch = std::move(batch)] {
+            std::vector<Generated> out;
+            out.reserve(batch.size());
+            for (u32 c : batch) out.push_back(generate(c));
+            std::lock_guard lock(m_mutex);
+            for (auto& g : out) m_done.push_back(std::move(g));
+            m_inFlight--;
+            m_idle.notify_all();
+        };
+        {
+            std::lock_guard lock(m_mutex);
+            m_inFlight++;
+        }
+        if (m_pool) m_pool->submit(std::move(job));
+        else job();
+    }
+
+    inline void place(Generated& g) {
+        float em = 1.f / m_rasterSize;
+        GlyphEntry entry;
+        entry.advance = g.metrics.advance * em;
+        if (!g.sdf.empty()) {
+            u32 w = g.metrics.width + 2 * m_spread;
+            u32 h = g.metrics.height + 2 * m_spread;
+            u32 x, y;
+            // One texel of gutter keeps bilinear taps inside the glyph
+            if (!m_packer.insert(w + 1, h + 1, x, y)) {
+                m_stats.rejected++;
+                logDebug("Glyph atlas full: dropping U+%04X", g.codepoint);
+            } else {
+                if (!dsa_enabled) m_texture.use();
+                m_texture.subImage(GL_RED, {i32(x), i32(y)}, {i32(w), i32(h)}, g.sdf.data());
+                m_stats.frameUploadBytes += g.sdf.size();
+                m_stats.frameUploads++;
+                entry.x = x;
+                entry.y = y;
+                entry.width = w;
+                entry.height = h;
+                entry.left = (g.metrics.left - i32(m_spread)) * em;
+                entry.top = (g.metrics.top + i32(m_spread)) * em;
+                entry.quadWidth = w * em;
+                entry.quadHeight = h * em;
+            }
+        }
+        m_glyphs[g.codepoint] = entry;
+    }
+
+public:
+    static constexpr u32 rectLocation = 0;
+    static constexpr u32 uvLocation = 1;
+    static constexpr u32 colorLocation = 2;
+
+    // Quads are in pixels with y down; `projection` maps them to clip space
+    static constexpr const char* vertexSource = R"(#version 330 core
+layout(location = 0) in vec4 rect;
+layout(location = 1) in vec4 uv;
+layout(location = 2) in vec4 color;
+uniform mat4 projection;
+out vec2 vUv;
+out vec4 vColor;
+void main() {
+    vec2 corner = vec2((gl_VertexID + 1) >> 1 & 1, gl_VertexID >> 1);
+    vUv = uv.xy + corner * uv.zw;
+    vColor = color;
+    gl_Position = projection * vec4(rect.xy + corner * rect.zw, 0.0, 1.0);
+}
+)";
+
+    // The edge is at 0.5; fwidth keeps it one pixel wide at every size
+    static constexpr const char* fragmentSource = R"(#version 330 core
+uniform sampler2D atlas;
+in vec2 vUv;
+in vec4 vColor;
+out vec4 fragColor;
+void main() {
+    float d = texture(atlas, vUv).r;
+    float w = max(fwidth(d), 1e-4) * 0.5;
+    fragColor = vec4(vColor.rgb, vColor.a * smoothstep(0.5 - w, 0.5 + w, d));
+}
+)";
+
+    inline GlyphAtlas(GlyphSource source, ThreadPool* pool = nullptr, u32 rasterSize = 48, u32 spread = 6, u32 width = 1024, u32 height = 1024)
+        : m_source(std::move(source)), m_pool(pool), m_rasterSize(rasterSize), m_spread(std::max(spread, 1u)),
+          m_width(width), m_height(height), m_texture(GL_LINEAR, GL_CLAMP_TO_EDGE), m_packer(width, height) {
+        std::vector<u8> clear(u64(width) * height);
+        m_texture.use();
+        m_texture.setImage(GL_R8, GL_RED, {i32(width), i32(height)}, clear.data());
+        m_texture.unuse();
+
+        m_vao.vertexBuffer(0, m_quads, 1);
+        m_vao.attribFormat(rectLocation, 4, GL_FLOAT, false, offsetof(GlyphQuad, rect), 0);
+        m_vao.attribFormat(uvLocation, 4, GL_FLOAT, false, offsetof(GlyphQuad, uv), 0);
+        m_vao.attribFormat(colorLocation, 4, GL_UNSIGNED_BYTE, true, offsetof(GlyphQuad, color), 0);
+        m_vao.unuse();
+        logDebug("Created glyph atlas %dx%d, %dpx glyphs", width, height, rasterSize);
+    }
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    // Queues generation of the codepoints not cached or in flight yet
+    inline GlyphAtlas& request(std::span<const u32> codepoints, u32 batch = 16) {
+        std::vector<u32> pending;
+        for (u32 c : codepoints) {
+            if (!m_requested.emplace(c, true).second) continue;
+            pending.push_back(c);
+            if (pending.size() == batch) {
+                submit(std::move(pending));
+                pending = {};
+            }
+        }
+        if (!pending.empty()) submit(std::move(pending));
+        return *this;
+    }
+
+    // Render thread: packs and uploads the glyphs finished since last time
+    inline GlyphAtlas& update() {
+        std::vector<Generated> done;
+        {
+            std::lock_guard lock(m_mutex);
+            done.swap(m_done);
+        }
+        m_stats.frameUploadBytes = 0;
+        m_stats.frameUploads = 0;
+        if (done.empty()) return *this;
+        // Rows are tightly packed bytes; the caller's alignment is put back
+        GLint alignment {};
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (auto& g : done) {
+            if (!g.ok) {
+                m_stats.missing++;
+                m_glyphs[g.codepoint] = {};
+                continue;
+            }
+            place(g);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+        m_stats.uploadedBytes += m_stats.frameUploadBytes;
+        return *this;
+    }
+
+    // Blocks until every queued glyph has been generated (not uploaded)
+    inline GlyphAtlas& wait() {
+        std::unique_lock lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_inFlight == 0; });
+        return *this;
+    }
+
+    inline const GlyphEntry* glyph(u32 codepoint) const {
+        auto it = m_glyphs.find(codepoint);
+        return it == m_glyphs.end() ? nullptr : &it->second;
+    }
+
+    // Appends quads for text with its baseline starting at pen, in pixels
+    // with y down; returns the pen after the last glyph. Glyphs that aren't
+    // ready yet are requested and skipped with a provisional advance.
+    inline Vec2 layout(std::u32string_view text, Vec2 pen, float pixelSize, RGBA color, std::vector<GlyphQuad>& out) {
+        float u = 1.f / m_width;
+        float v = 1.f / m_height;
+        for (char32_t c : text) {
+            const GlyphEntry* g = glyph(c);
+            if (!g) {
+                u32 cp = c;
+                request(std::span<const u32>(&cp, 1));
+                pen.x += 0.5f * pixelSize;
+                continue;
+            }
+            if (g->width) {
+                out.push_back({
+                    {pen.x + g->left * pixelSize, pen.y - g->top * pixelSize, g->quadWidth * pixelSize, g->quadHeight * pixelSize},
+                    {g->x * u, g->y * v, g->width * u, g->height * v},
+                    color
+                });
+            }
+            pen.x += g->advance * pixelSize;
+        }
+        return pen;
+    }
+
+    // Streams the quads and draws them with one instanced call; shader is
+    // compiled from vertexSource/fragmentSource or follows their layout
+    inline GlyphAtlas& draw(Shader& shader, std::span<const GlyphQuad> quads, u32 unit = 0) {
+        if (quads.empty()) return *this;
+        if (!dsa_enabled) m_quads.use();
+        m_quads.bufferData(const_cast<GlyphQuad*>(quads.data()), quads.size_bytes(), GL_STREAM_DRAW);
+        shader.use().uniform("atlas", i32(unit));
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_texture.use();
+        m_vao.use();
+        drawSquareInstanced(quads.size());
+        m_vao.unuse();
+        return *this;
+    }
+
+    inline Texture<GL_TEXTURE_2D>& texture() { return m_texture; }
+    inline u32 rasterSize() const { return m_rasterSize; }
+    inline float occupancy() const { return m_packer.occupancy(); }
+
+    // Generation counters are read from the workers at call time
+    inline GlyphStats stats() const {
+        GlyphStats s = m_stats;
+        s.generated = m_generated.load();
+        s.generateNs = m_generateNs.load();
+        return s;
+    }
+
+    inline ~GlyphAtlas() {
+        wait();
+        logDebug("Destroyed glyph atlas");
+    }
+};
+
+};
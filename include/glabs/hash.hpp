@@ -0,0 +1,17 @@
+#pragma once
+#include <cpputils/types.hpp>
+
+namespace GL {
+
+// FNV-1a, used to key caches by content
+constexpr u64 hash64(const void* data, std::size_t size, u64 seed = 0xcbf29ce484222325ull) {
+    const u8* p = static_cast<const u8*>(data);
+    u64 h = seed;
+    for (std::size_t i {}; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+};
@@ -3,16 +3,19 @@
 #include <cpputils/debug.hpp>
 #include <cpputils/error.hpp>
 
+#include "backend.hpp"
+
 namespace GL {
 
 template<typename T>
-inline void load(T* (*addr) (const char*)) { 
+inline void load(T* (*addr) (const char*), bool allow_dsa = true) { 
     logDebug("Initializing glad"); 
     if (!gladLoadGLLoader((GLADloadproc) addr)) {
         abort("Initializing glad");
     }
 
     logDebug("Status: Using OpenGL Core 3.3");
+    selectBackend(allow_dsa);
 }
 
 inline void unload() {
@@ -0,0 +1,290 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+
+#include "registry.hpp"
+
+namespace GL {
+
+enum class MemoryCategory : u8 {
+    Texture,
+    Vertex,
+    Index,
+    Uniform,
+    Other,
+    Count
+};
+
+struct MemoryStats {
+    u64 bytes[static_cast<u32>(MemoryCategory::Count)] {};
+    u64 total {};
+    u64 peak {};
+    u64 budget {};
+    u32 resources {};
+    u32 evictions {};
+    u64 evictedBytes {};
+};
+
+// Identifies a GL object across kinds
+constexpr u64 resourceKey(ResourceKind kind, u32 name) {
+    return (u64(kind) << 32) | name;
+}
+
+// Driver-side size of one image level, padding 3-channel formats to 4 bytes
+// like most drivers do
+constexpr u64 textureBytes(i32 internalformat, u32 width, u32 height = 1, u32 depth = 1) {
+    u64 texels = u64(width) * height * depth;
+    u64 blocks = u64((width + 3) / 4) * ((height + 3) / 4) * depth;
+    switch (internalformat) {
+    case GL_R8: case GL_RED: case GL_STENCIL_INDEX8:
+        return texels;
+    case GL_RG8: case GL_R16F: case GL_R16: case GL_RG: case GL_DEPTH_COMPONENT16:
+        return texels * 2;
+    case GL_RG16F: case GL_RG16: case GL_R32F: case GL_R32UI: case GL_R32I:
+    case GL_RGB8: case GL_RGBA8: case GL_SRGB8: case GL_SRGB8_ALPHA8: case GL_RGB: case GL_RGBA:
+    case GL_RGB10_A2: case GL_R11F_G11F_B10F: case GL_RGB9_E5:
+    case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8: case GL_DEPTH_COMPONENT:
+        return texels * 4;
+    case GL_RGBA16F: case GL_RGB16F: case GL_RGBA16: case GL_RG32F: case GL_DEPTH32F_STENCIL8:
+        return texels * 8;
+    case GL_RGBA32F: case GL_RGB32F: case GL_RGBA32UI: case GL_RGBA32I:
+        return texels * 16;
+    case GL_COMPRESSED_RED_RGTC1: case GL_COMPRESSED_SIGNED_RED_RGTC1:
+        return blocks * 8;
+    case GL_COMPRESSED_RG_RGTC2: case GL_COMPRESSED_SIGNED_RG_RGTC2:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM: case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT: case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+        return blocks * 16;
+    default:
+        return texels * 4;
+    }
+}
+
+// Sum of a full mip chain starting at the given size
+constexpr u64 textureChainBytes(i32 internalformat, u32 width, u32 height, u32 depth, u32 levels) {
+    u64 total {};
+    for (u32 l {}; l < levels; l++) {
+        total += textureBytes(internalformat, width, height, depth);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        depth = depth > 1 ? depth / 2 : 1;
+    }
+    return total;
+}
+
+// Accounts GPU allocations per resource (and per mip level), keeps them in
+// least-recently-used order and evicts through user callbacks when the total
+// goes over budget. Accounting is thread safe, since wrappers record from
+// worker jobs too. record() only accounts: it runs in the middle of uploads
+// to the caller's bound objects, where an evictor would disturb them. Going
+// over budget is settled by enforce() on the context thread (the
+// constructing one, see setContextThread), which FrameScheduler::endFrame
+// calls once a frame.
+class MemoryTracker {
+    static constexpr u32 maxLevels = 16;
+
+    struct Entry {
+        MemoryCategory category;
+        u64 levels[maxLevels];
+        u64 bytes;
+        std::function<void()> evict;
+        std::list<u64>::iterator lru;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<u64, Entry> m_entries;
+    std::list<u64> m_lru; // Front is most recently used
+    MemoryStats m_stats;
+    std::thread::id m_contextThread {std::this_thread::get_id()};
+    bool m_enforcing {};    // Context thread only
+
+    inline void add(MemoryCategory category, i64 delta) {
+        m_stats.bytes[static_cast<u32>(category)] += delta;
+        m_stats.total += delta;
+        if (m_stats.total > m_stats.peak) m_stats.peak = m_stats.total;
+    }
+
+    inline void touchLocked(u64 key) {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) return;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    }
+
+    inline bool overBudgetLocked() const {
+        return m_stats.budget && m_stats.total > m_stats.budget;
+    }
+
+public:
+    // budget in bytes, 0 for unlimited
+    inline MemoryTracker(u64 budget = 0) {
+        m_stats.budget = budget;
+    }
+
+    // The thread enforce() evicts on, the constructing one by default
+    inline void setContextThread() {
+        std::lock_guard lock(m_mutex);
+        m_contextThread = std::this_thread::get_id();
+    }
+
+    // Sets the size of one level of a resource, replacing the previous value
+    inline void record(u64 key, MemoryCategory category, u64 bytes, u32 level = 0) {
+        if (level >= maxLevels) return;
+        std::lock_guard lock(m_mutex);
+        auto [it, inserted] = m_entries.try_emplace(key);
+        Entry& e = it->second;
+        if (inserted) {
+            e.category = category;
+            std::memset(e.levels, 0, sizeof(e.levels));
+            e.bytes = 0;
+            m_lru.push_front(key);
+            e.lru = m_lru.begin();
+            m_stats.resources++;
+        }
+        i64 delta = i64(bytes) - i64(e.levels[level]);
+        e.levels[level] = bytes;
+        e.bytes += delta;
+        add(e.category, delta);
+        touchLocked(key);
+    }
+
+    inline void forget(u64 key) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) return;
+        add(it->second.category, -i64(it->second.bytes));
+        m_lru.erase(it->second.lru);
+        m_entries.erase(it);
+        m_stats.resources--;
+    }
+
+    inline void touch(u64 key) {
+        std::lock_guard lock(m_mutex);
+        touchLocked(key);
+    }
+
+    // Makes a resource evictable. The callback must release the GPU storage
+    // (which records the new, smaller size), e.g. after copying it to a CPU
+    // cache or arranging for it to be reloaded.
+    inline void setEvictor(u64 key, std::function<void()> evict) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) it->second.evict = std::move(evict);
+    }
+
+    // Takes effect at the next enforce()
+    inline void setBudget(u64 budget) {
+        std::lock_guard lock(m_mutex);
+        m_stats.budget = budget;
+    }
+
+    // True once recorded sizes exceed the budget, until enforce() fits them
+    inline bool overBudget() {
+        std::lock_guard lock(m_mutex);
+        return overBudgetLocked();
+    }
+
+    // Context thread, outside any upload, e.g. between frames: evicts least
+    // recently used resources until the total fits the budget. Returns the
+    // number of resources evicted; other threads get 0.
+    inline u32 enforce() {
+        std::unique_lock lock(m_mutex);
+        if (!overBudgetLocked() || m_enforcing || std::this_thread::get_id() != m_contextThread) return 0;
+        m_enforcing = true;
+        u32 evicted {};
+        // Callbacks re-record sizes, which reorders the list, so walk a copy
+        std::vector<u64> order(m_lru.rbegin(), m_lru.rend());
+        for (u64 key : order) {
+            if (!overBudgetLocked()) break;
+            auto found = m_entries.find(key);
+            if (found == m_entries.end()) continue;
+            Entry& e = found->second;
+            if (!e.evict || e.bytes == 0) continue;
+
+            u64 before = e.bytes;
+            auto evict = std::move(e.evict);
+            // The callback records the new size, which takes the lock
+            lock.unlock();
+            evict();
+            lock.lock();
+            // The callback may have forgotten the entry altogether. An evictor
+            // that had nothing to free this time stays registered for later.
+            auto after = m_entries.find(key);
+            u64 freed = after == m_entries.end() ? before : before - std::min(before, after->second.bytes);
+            if (after != m_entries.end() && !after->second.evict) after->second.evict = std::move(evict);
+            if (!freed) continue;
+
+            m_stats.evictions++;
+            m_stats.evictedBytes += freed;
+            evicted++;
+            logDebug("Evicted resource %llx (%llu bytes)", (unsigned long long) key, (unsigned long long) freed);
+        }
+        m_enforcing = false;
+        return evicted;
+    }
+
+    inline u64 bytes(u64 key) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_entries.find(key);
+        return it == m_entries.end() ? 0 : it->second.bytes;
+    }
+
+    // A snapshot, since other threads may be recording
+    inline MemoryStats stats() {
+        std::lock_guard lock(m_mutex);
+        return m_stats;
+    }
+
+    // Free video memory reported by the driver in KiB, or -1 when neither
+    // GL_NVX_gpu_memory_info nor GL_ATI_meminfo is available
+    static inline i64 deviceAvailableKB() {
+        static const i32 vendor = [] {
+            GLint count {};
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i {}; i < count; i++) {
+                auto* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                if (!ext) continue;
+                if (std::strcmp(ext, "GL_NVX_gpu_memory_info") == 0) return 1;
+                if (std::strcmp(ext, "GL_ATI_meminfo") == 0) return 2;
+            }
+            return 0;
+        }();
+
+        GLint values[4] {};
+        switch (vendor) {
+        case 1:
+            glGetIntegerv(0x9049, values); // GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+            return values[0];
+        case 2:
+            glGetIntegerv(0x87FC, values); // GL_TEXTURE_FREE_MEMORY_ATI
+            return values[0];
+        default:
+            return -1;
+        }
+    }
+};
+
+// When set, Texture/VBO/EBO uploads are recorded here and binds count as use
+inline MemoryTracker* memory_tracker {};
+
+inline void trackMemory(ResourceKind kind, u32 name, MemoryCategory category, u64 bytes, u32 level = 0) {
+    if (memory_tracker) memory_tracker->record(resourceKey(kind, name), category, bytes, level);
+}
+
+inline void untrackMemory(ResourceKind kind, u32 name) {
+    if (memory_tracker) memory_tracker->forget(resourceKey(kind, name));
+}
+
+inline void touchMemory(ResourceKind kind, u32 name) {
+    if (memory_tracker) memory_tracker->touch(resourceKey(kind, name));
+}
+
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <span>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+
+#include "meshformat.hpp"
+#include "vbo.hpp"
+#include "ebo.hpp"
+
+namespace GL {
+
+// Read-only mapping of a whole file
+class MappedFile {
+    void* m_data {};
+    u64 m_size {};
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) return false;
+        m_data = data;
+        m_size = st.st_size;
+        return true;
+    }
+
+    inline void close() {
+        if (m_data) munmap(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    inline const u8* data() const {
+        return static_cast<const u8*>(m_data);
+    }
+
+    inline u64 size() const {
+        return m_size;
+    }
+
+    inline ~MappedFile() {
+        close();
+    }
+};
+
+// A .glbm file mapped into memory and checked against VBO<Ts...>'s record
+// type. upload() hands the mapped sections straight to the driver.
+template<typename... Ts>
+class MeshFile {
+public:
+    using type = typename VBO<Ts...>::type;
+
+private:
+    MappedFile m_file;
+    const MeshHeader* m_header {};
+
+public:
+    inline bool open(const char* path) {
+        m_header = nullptr;
+        if (!m_file.open(path)) {
+            logDebug("Mesh %s: could not map file", path);
+            return false;
+        }
+        const char* reason {};
+        auto* header = reinterpret_cast<const MeshHeader*>(m_file.data());
+        if (!meshCompatible<type>(*header, m_file.size(), &reason)) {
+            logDebug("Mesh %s: %s", path, reason);
+            m_file.close();
+            return false;
+        }
+        m_header = header;
+        // Uploads read the file front to back once
+        madvise(const_cast<u8*>(m_file.data()), m_file.size(), MADV_SEQUENTIAL);
+        return true;
+    }
+
+    inline std::span<const type> vertices() const {
+        if (!m_header) return {};
+        return {reinterpret_cast<const type*>(m_file.data() + m_header->vertexOffset), m_header->vertexCount};
+    }
+
+    inline std::span<const u32> indices() const {
+        if (!m_header) return {};
+        return {reinterpret_cast<const u32*>(m_file.data() + m_header->indexOffset), m_header->indexCount};
+    }
+
+    inline u32 vertexCount() const {
+        return m_header ? m_header->vertexCount : 0;
+    }
+
+    inline u32 indexCount() const {
+        return m_header ? m_header->indexCount : 0;
+    }
+
+    // Leaves both buffers bound
+    inline void upload(VBO<Ts...>& vbo, EBO& ebo, u32 draw_type = GL_STATIC_DRAW) const {
+        auto v = vertices();
+        auto i = indices();
+        vbo.use();
+        vbo.bufferData(v, draw_type);
+        ebo.use();
+        ebo.bufferData(i, draw_type);
+    }
+
+    // The mapping is only needed until upload() returns
+    inline void close() {
+        m_file.close();
+        m_header = nullptr;
+    }
+};
+
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <cpputils/types.hpp>
+#include <cpputils/tuple.hpp>
+#include <cpputils/constexpr_for.hpp>
+#include <cppmaths/vec.hpp>
+#include <cppmaths/mat.hpp>
+
+#include "color.hpp"
+#include "bones.hpp"
+
+namespace GL {
+
+// Binary mesh container (.glbm). Vertex records are stored exactly as the
+// VBO Tuple lays them out, so a mapped file uploads without any parsing:
+//
+//   MeshHeader | vertices (vertexCount * vertexStride) | indices (u32)
+//
+// Both sections start on a meshAlignment boundary.
+
+constexpr u32 meshVersion = 1;
+constexpr u32 meshAlignment = 64;
+constexpr u32 meshMaxAttribs = 16;
+
+enum class MeshComponent : u8 {
+    Unknown,
+    Float,
+    UByte
+};
+
+struct MeshAttrib {
+    MeshComponent component;
+    u8 count;       // Components per column
+    u8 columns;     // 1 for vectors, N for matrices
+    u8 normalized;
+    u32 offset;     // Byte offset inside the vertex record
+
+    constexpr bool operator==(const MeshAttrib&) const = default;
+};
+
+struct MeshHeader {
+    char magic[4];
+    u32 version;
+    u32 vertexStride;
+    u32 attribCount;
+    u32 vertexCount;
+    u32 indexCount;
+    u64 vertexOffset;
+    u64 indexOffset;
+    MeshAttrib attribs[meshMaxAttribs];
+};
+
+template<typename T>
+constexpr MeshAttrib meshAttribOf = {MeshComponent::Unknown, 0, 0, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<float> = {MeshComponent::Float, 1, 1, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<Vec2> = {MeshComponent::Float, 2, 1, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<Vec3> = {MeshComponent::Float, 3, 1, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<Vec4> = {MeshComponent::Float, 4, 1, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<Mat3> = {MeshComponent::Float, 3, 3, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<Mat4> = {MeshComponent::Float, 4, 4, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<RGB> = {MeshComponent::UByte, 3, 1, 1, 0};
+template<> constexpr MeshAttrib meshAttribOf<RGBA> = {MeshComponent::UByte, 4, 1, 1, 0};
+template<> constexpr MeshAttrib meshAttribOf<BoneIndices> = {MeshComponent::UByte, 4, 1, 0, 0};
+template<> constexpr MeshAttrib meshAttribOf<BoneWeights> = {MeshComponent::UByte, 4, 1, 1, 0};
+
+// Attribute table describing a VBO record type (a Tuple or a single element)
+template<typename Tupl>
+struct MeshLayout {
+    u32 count {};
+    MeshAttrib attribs[meshMaxAttribs] {};
+
+    constexpr MeshLayout() {
+        if constexpr (IsTuple<Tupl>) {
+            constexpr_for(u32 i=0, i<TupleSize<Tupl>, i+1,
+                MeshAttrib a = meshAttribOf<TupleElement<i, Tupl>>;
+                a.offset = tupleOffset<i, Tupl>();
+                attribs[count++] = a;
+            );
+        } else {
+            attribs[count++] = meshAttribOf<Tupl>;
+        }
+    }
+
+    constexpr bool known() const {
+        for (u32 i {}; i < count; i++) {
+            if (attribs[i].component == MeshComponent::Unknown) return false;
+        }
+        return count <= meshMaxAttribs;
+    }
+};
+
+constexpr u64 meshAlign(u64 offset) {
+    return (offset + meshAlignment - 1) / meshAlignment * meshAlignment;
+}
+
+template<typename Tupl>
+inline MeshHeader meshHeader(u32 vertexCount, u32 indexCount) {
+    constexpr MeshLayout<Tupl> layout;
+    static_assert(layout.known(), "Tuple has an element with no mesh attribute descriptor");
+
+    MeshHeader h {};
+    std::memcpy(h.magic, "GLBM", 4);
+    h.version = meshVersion;
+    h.vertexStride = sizeof(Tupl);
+    h.attribCount = layout.count;
+    h.vertexCount = vertexCount;
+    h.indexCount = indexCount;
+    h.vertexOffset = meshAlign(sizeof(MeshHeader));
+    h.indexOffset = meshAlign(h.vertexOffset + u64(vertexCount) * sizeof(Tupl));
+    for (u32 i {}; i < layout.count; i++) h.attribs[i] = layout.attribs[i];
+    return h;
+}
+
+// Writes vertex records (vertexCount * sizeof(Tupl) bytes) and indices
+template<typename Tupl>
+inline bool writeMesh(const char* path, const void* vertices, u32 vertexCount, std::span<const u32> indices) {
+    MeshHeader h = meshHeader<Tupl>(vertexCount, indices.size());
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+
+    static const u8 zeros[meshAlignment] {};
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+    ok = ok && std::fwrite(zeros, 1, h.vertexOffset - sizeof(h), f) == h.vertexOffset - sizeof(h);
+    u64 vertexBytes = u64(vertexCount) * sizeof(Tupl);
+    ok = ok && std::fwrite(vertices, 1, vertexBytes, f) == vertexBytes;
+    u64 pad = h.indexOffset - h.vertexOffset - vertexBytes;
+    ok = ok && std::fwrite(zeros, 1, pad, f) == pad;
+    ok = ok && std::fwrite(indices.data(), sizeof(u32), indices.size(), f) == indices.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+// Checks a header read from disk against the record type it will be loaded as
+template<typename Tupl>
+inline bool meshCompatible(const MeshHeader& h, u64 fileSize, const char** reason = nullptr) {
+    constexpr MeshLayout<Tupl> layout;
+    static_assert(layout.known(), "Tuple has an element with no mesh attribute descriptor");
+
+    auto fail = [&](const char* why) {
+        if (reason) *reason = why;
+        return false;
+    };
+    if (fileSize < sizeof(MeshHeader)) return fail("file too small");
+    if (std::memcmp(h.magic, "GLBM", 4) != 0) return fail("bad magic");
+    if (h.version != meshVersion) return fail("unsupported version");
+    if (h.vertexStride != sizeof(Tupl)) return fail("vertex stride does not match tuple");
+    if (h.attribCount != layout.count) return fail("attribute count does not match tuple");
+    for (u32 i {}; i < layout.count; i++) {
+        if (!(h.attribs[i] == layout.attribs[i])) return fail("attribute layout does not match tuple");
+    }
+    if (h.vertexOffset % meshAlignment || h.indexOffset % meshAlignment) return fail("misaligned section");
+    // Offsets come from the file: compare against remaining sizes, never
+    // add to them, so crafted values can't wrap past the checks
+    if (h.vertexOffset < sizeof(MeshHeader) || h.vertexOffset > h.indexOffset) return fail("overlapping sections");
+    if (h.indexOffset > fileSize) return fail("truncated file");
+    if (u64(h.vertexCount) * h.vertexStride > h.indexOffset - h.vertexOffset) return fail("overlapping sections");
+    if (h.indexCount > (fileSize - h.indexOffset) / sizeof(u32)) return fail("truncated file");
+    return true;
+}
+
+};
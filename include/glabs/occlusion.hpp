@@ -0,0 +1,272 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/error.hpp>
+#include <cppmaths/mat.hpp>
+
+#include "backend.hpp"
+#include "registry.hpp"
+#include "vao.hpp"
+#include "shader.hpp"
+
+namespace GL {
+
+// Query objects of one target, taken in blocks through genName and
+// recycled, so testing thousands of objects doesn't cost a name per object.
+// With a ResourceRegistry the names come from its pool and their deletion
+// waits for the frame's fence like any other object.
+class QueryPool {
+    u32 m_target;
+    u32 m_block;
+    std::vector<u32> m_all;
+    std::vector<u32> m_free;
+
+public:
+    inline QueryPool(u32 target = GL_ANY_SAMPLES_PASSED, u32 block = 64)
+        : m_target(target), m_block(std::max(block, 1u)) {
+
+    }
+
+    QueryPool(const QueryPool&) = delete;
+    QueryPool& operator=(const QueryPool&) = delete;
+
+    inline u32 acquire() {
+        if (m_free.empty()) {
+            m_free.resize(m_block);
+            for (u32& query : m_free) query = genName(ResourceKind::Query);
+            m_all.insert(m_all.end(), m_free.begin(), m_free.end());
+            logDebug("Query pool: %d queries", m_all.size());
+        }
+        u32 query = m_free.back();
+        m_free.pop_back();
+        return query;
+    }
+
+    // A released query may still be pending; its result is simply dropped
+    // when it is begun again
+    inline void release(u32 query) {
+        m_free.push_back(query);
+    }
+
+    inline u32 target() const { return m_target; }
+    inline u32 size() const { return m_all.size(); }
+    inline u32 available() const { return m_free.size(); }
+
+    inline ~QueryPool() {
+        for (u32 query : m_all) deleteName(ResourceKind::Query, query);
+    }
+};
+
+enum class OcclusionMode : u8 {
+    Conditional,    // The GPU skips occluded draws itself (GL_QUERY_NO_WAIT)
+    LastFrame       // The CPU skips draws whose newest result was occluded
+};
+
+struct OcclusionStats {
+    u64 tests {};           // Proxies drawn under a query
+    u64 draws {};           // Gated draws submitted
+    u64 culled {};          // Gated draws skipped, or known occluded under Conditional
+    u64 unresolved {};      // Queries reused before their result arrived
+};
+
+// Gates expensive draws on cheap bounding proxies rendered with
+// GL_ANY_SAMPLES_PASSED queries. Each frame: beginTests(), test() every
+// object against the depth buffer laid down by the occluders, endTests(),
+// then draw() each object. Results are only polled, never waited for; an
+// object with no result yet counts as visible. Each object cycles through
+// `latency` queries so a new test can start while older ones are in flight.
+class OcclusionCuller {
+    static constexpr u32 maxLatency = 4;
+
+    struct Object {
+        u32 queries[maxLatency] {};
+        u32 head {};        // Next query to begin
+        u32 inFlight {};
+        u32 latest {};      // Query of the newest test, 0 before the first
+        bool visible {true};
+        bool alive {};
+    };
+
+    OcclusionMode m_mode;
+    u32 m_latency;
+    QueryPool m_pool;
+    std::vector<Object> m_objects;
+    std::vector<u32> m_freeIds;
+    OcclusionStats m_stats;
+
+    Shader m_boxShader;
+    VAO m_boxVao;
+    bool m_compiled {};
+
+    GLboolean m_colorMask[4] {};
+    GLboolean m_depthMask {};
+    GLboolean m_cullFace {};
+
+    inline Object& object(u32 id) {
+        if (id >= m_objects.size() || !m_objects[id].alive) {
+            abort("OcclusionCuller: unknown object");
+        }
+        return m_objects[id];
+    }
+
+    // Consumes the results that are ready, oldest first
+    inline void poll(Object& o) {
+        while (o.inFlight) {
+            u32 query = o.queries[(o.head + m_latency - o.inFlight) % m_latency];
+            GLuint ready {};
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (!ready) break;
+            GLuint passed {};
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT, &passed);
+            o.visible = passed != 0;
+            o.inFlight--;
+        }
+    }
+
+    // Unit cube [-1, 1]^3 as a 14 vertex strip generated from gl_VertexID
+    static constexpr const char* boxVertexSource = R"(#version 330 core
+uniform mat4 boxToClip;
+void main() {
+    int b = 1 << gl_VertexID;
+    vec3 p = vec3((0x287a & b) != 0, (0x02af & b) != 0, (0x31e3 & b) != 0) * 2.0 - 1.0;
+    gl_Position = boxToClip * vec4(p, 1.0);
+}
+)";
+
+    static constexpr const char* boxFragmentSource = R"(#version 330 core
+void main() {}
+)";
+
+public:
+    inline OcclusionCuller(OcclusionMode mode = OcclusionMode::Conditional, u32 latency = 3)
+        : m_mode(mode), m_latency(std::clamp(latency, 1u, maxLatency)),
+          m_boxShader(boxVertexSource, boxFragmentSource) {
+
+    }
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    inline u32 add() {
+        u32 id;
+        if (!m_freeIds.empty()) {
+            id = m_freeIds.back();
+            m_freeIds.pop_back();
+        } else {
+            id = m_objects.size();
+            m_objects.emplace_back();
+        }
+        Object& o = m_objects[id];
+        o = {};
+        o.alive = true;
+        for (u32 i {}; i < m_latency; i++) o.queries[i] = m_pool.acquire();
+        return id;
+    }
+
+    inline void remove(u32 id) {
+        Object& o = object(id);
+        for (u32 i {}; i < m_latency; i++) m_pool.release(o.queries[i]);
+        o.alive = false;
+        m_freeIds.push_back(id);
+    }
+
+    // Proxies write neither color nor depth and keep back faces, so a box
+    // cut by the near plane still shows its far side
+    inline OcclusionCuller& beginTests() {
+        glGetBooleanv(GL_COLOR_WRITEMASK, m_colorMask);
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &m_depthMask);
+        m_cullFace = glIsEnabled(GL_CULL_FACE);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+        return *this;
+    }
+
+    inline OcclusionCuller& endTests() {
+        glColorMask(m_colorMask[0], m_colorMask[1], m_colorMask[2], m_colorMask[3]);
+        glDepthMask(m_depthMask);
+        if (m_cullFace) glEnable(GL_CULL_FACE);
+        return *this;
+    }
+
+    // Runs drawProxy under a fresh query for the object
+    template<typename F>
+    inline OcclusionCuller& test(u32 id, F&& drawProxy) {
+        Object& o = object(id);
+        poll(o);
+        if (o.inFlight == m_latency) {
+            o.inFlight--;
+            m_stats.unresolved++;
+        }
+        u32 query = o.queries[o.head];
+        glBeginQuery(m_pool.target(), query);
+        drawProxy();
+        glEndQuery(m_pool.target());
+        o.latest = query;
+        o.head = (o.head + 1) % m_latency;
+        o.inFlight++;
+        m_stats.tests++;
+        return *this;
+    }
+
+    // Tests the unit cube transformed by boxToClip, e.g.
+    // viewProjection * translate(center) * scale(halfExtents)
+    inline OcclusionCuller& testBox(u32 id, const Mat4& boxToClip) {
+        if (!m_compiled) {
+            m_boxShader.compile();
+            m_compiled = true;
+        }
+        m_boxShader.use().uniform("boxToClip", boxToClip);
+        m_boxVao.use();
+        test(id, [] { glDrawArrays(GL_TRIANGLE_STRIP, 0, 14); });
+        m_boxVao.unuse();
+        return *this;
+    }
+
+    // Issues draw unless the object is known to be occluded; returns whether
+    // it was submitted. Under Conditional the GPU still has the last word.
+    template<typename F>
+    inline bool draw(u32 id, F&& draw) {
+        Object& o = object(id);
+        poll(o);
+        if (m_mode == OcclusionMode::LastFrame) {
+            if (!o.visible) {
+                m_stats.culled++;
+                return false;
+            }
+            draw();
+            m_stats.draws++;
+            return true;
+        }
+
+        if (!o.visible) m_stats.culled++;
+        if (o.latest) glBeginConditionalRender(o.latest, GL_QUERY_NO_WAIT);
+        draw();
+        if (o.latest) glEndConditionalRender();
+        m_stats.draws++;
+        return true;
+    }
+
+    // Newest available result; true until the first one arrives
+    inline bool visible(u32 id) {
+        Object& o = object(id);
+        poll(o);
+        return o.visible;
+    }
+
+    inline OcclusionMode mode() const { return m_mode; }
+    inline const QueryPool& pool() const { return m_pool; }
+
+    inline const OcclusionStats& stats() const {
+        return m_stats;
+    }
+
+    inline void resetStats() {
+        m_stats = {};
+    }
+};
+
+};
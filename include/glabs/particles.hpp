@@ -0,0 +1,258 @@
+#pragma once
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/tuple.hpp>
+#include <cppmaths/vec.hpp>
+
+#include "color.hpp"
+#include "backend.hpp"
+#include "registry.hpp"
+#include "vbo.hpp"
+#include "vao.hpp"
+#include "shader.hpp"
+#include "gl.hpp"
+
+namespace GL {
+
+// position, velocity, color, remaining life in seconds (dead at <= 0)
+using Particle = Tuple<Vec3, Vec3, RGBA, float>;
+
+struct ParticleStats {
+    u64 steps {};
+    u64 emitted {};
+    u32 emitWrites {};      // glBufferSubData calls made for emitters
+    u64 emitBytes {};
+};
+
+// Particle state lives in two GPU buffers. step() runs the update shader
+// over one with transform feedback capturing into the other, then swaps;
+// draw() instances a quad per particle straight out of the latest buffer.
+// Nothing is read back, and emitters only write the slots they replace.
+//
+// Shader contract (see the default sources below): inputs at the
+// *Location constants, and the update shader captures `varyings` in order,
+// with the color packed to a uint (packUnorm4x8 layout) since feedback can't
+// write bytes. Pass varyings to Shader::feedbackVaryings before compile().
+// Runs on GL 3.3: feedback objects (GL 4.0) are used when available, else
+// the buffer is bound to the default feedback object at every step().
+class ParticleSystem {
+    using Buffer = VBO<Vec3, Vec3, RGBA, float>;
+
+    u32 m_capacity;
+    Buffer m_state[2];
+    VAO m_update[2];        // Per-vertex fetch from m_state[i]
+    VAO m_render[2];        // Per-instance fetch from m_state[i]
+    u32 m_feedback[2] {};   // Capture into m_state[i]; 0 before GL 4.0
+    u32 m_current {};       // Buffer holding the latest state
+    u32 m_head {};          // Next slot an emitter overwrites
+    std::vector<Particle> m_pending;
+    u32 m_pendingSlot {};
+    ParticleStats m_stats;
+
+    static_assert(sizeof(Particle) == 32, "Particle must match the packed feedback layout");
+
+    inline void layout(VAO& vao, Buffer& buffer, u32 divisor) {
+        vao.vertexBuffer(0, buffer, divisor);
+        vao.attribFormat(positionLocation, 3, GL_FLOAT, false, tupleOffset<0, Particle>(), 0);
+        vao.attribFormat(velocityLocation, 3, GL_FLOAT, false, tupleOffset<1, Particle>(), 0);
+        vao.attribFormat(colorLocation, 4, GL_UNSIGNED_BYTE, true, tupleOffset<2, Particle>(), 0);
+        vao.attribFormat(lifeLocation, 1, GL_FLOAT, false, tupleOffset<3, Particle>(), 0);
+    }
+
+    // Pending emits become at most two sub-range writes (the ring may wrap)
+    inline void flushEmits() {
+        if (m_pending.empty()) return;
+        Buffer& target = m_state[m_current];
+        if (!dsa_enabled) target.use();
+        u32 first = std::min<u32>(m_pending.size(), m_capacity - m_pendingSlot);
+        auto* data = reinterpret_cast<Vec3*>(m_pending.data());
+        target.bufferSubData(data, first * sizeof(Particle), m_pendingSlot * sizeof(Particle));
+        m_stats.emitWrites++;
+        if (first < m_pending.size()) {
+            target.bufferSubData(reinterpret_cast<Vec3*>(m_pending.data() + first), (m_pending.size() - first) * sizeof(Particle), 0);
+            m_stats.emitWrites++;
+        }
+        m_stats.emitBytes += m_pending.size() * sizeof(Particle);
+        m_pending.clear();
+    }
+
+public:
+    static constexpr u32 positionLocation = 0;
+    static constexpr u32 velocityLocation = 1;
+    static constexpr u32 colorLocation = 2;
+    static constexpr u32 lifeLocation = 3;
+
+    static constexpr const char* varyings[] {"outPosition", "outVelocity", "outColor", "outLife"};
+
+    // Integrates velocity under `gravity` and ages particles by `deltaTime`
+    static constexpr const char* updateSource = R"(#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 velocity;
+layout(location = 2) in vec4 color;
+layout(location = 3) in float life;
+uniform float deltaTime;
+uniform vec3 gravity;
+out vec3 outPosition;
+out vec3 outVelocity;
+flat out uint outColor;
+out float outLife;
+void main() {
+    float dt = life > 0.0 ? deltaTime : 0.0;
+    outVelocity = velocity + gravity * dt;
+    outPosition = position + outVelocity * dt;
+    // packUnorm4x8 without GLSL 4.00
+    uvec4 c = uvec4(round(clamp(color, 0.0, 1.0) * 255.0));
+    outColor = c.x | c.y << 8 | c.z << 16 | c.w << 24;
+    outLife = life - dt;
+}
+)";
+
+    // Never runs: step() enables GL_RASTERIZER_DISCARD
+    static constexpr const char* discardSource = R"(#version 330 core
+void main() {}
+)";
+
+    // Camera-facing quads of half-size `size`; dead particles are clipped
+    static constexpr const char* renderVertexSource = R"(#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec4 color;
+layout(location = 3) in float life;
+uniform mat4 viewProjection;
+uniform vec3 cameraRight;
+uniform vec3 cameraUp;
+uniform float size;
+out vec4 vColor;
+out vec2 vCorner;
+void main() {
+    // drawSquareInstanced fan order: bottom left, bottom right, top right, top left
+    vCorner = vec2((gl_VertexID + 1) >> 1 & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vColor = color;
+    vec3 p = position + (cameraRight * vCorner.x + cameraUp * vCorner.y) * size;
+    gl_Position = life > 0.0 ? viewProjection * vec4(p, 1.0) : vec4(2.0, 2.0, 2.0, 1.0);
+}
+)";
+
+    static constexpr const char* renderFragmentSource = R"(#version 330 core
+in vec4 vColor;
+in vec2 vCorner;
+out vec4 fragColor;
+void main() {
+    float falloff = 1.0 - dot(vCorner, vCorner);
+    if (falloff <= 0.0) discard;
+    fragColor = vec4(vColor.rgb, vColor.a * falloff);
+}
+)";
+
+    inline ParticleSystem(u32 capacity) : m_capacity(std::max(capacity, 1u)) {
+        // Start with every slot dead
+        std::vector<u8> zeros(m_capacity * sizeof(Particle));
+        for (u32 i {}; i < 2; i++) {
+            if (!dsa_enabled) m_state[i].use();
+            m_state[i].bufferData(reinterpret_cast<Vec3*>(zeros.data()), zeros.size(), GL_DYNAMIC_COPY);
+            layout(m_update[i], m_state[i], 0);
+            layout(m_render[i], m_state[i], 1);
+
+            if (!GLAD_GL_VERSION_4_0) continue;
+            m_feedback[i] = genName(ResourceKind::TransformFeedback);
+            if (dsa_enabled) {
+                glTransformFeedbackBufferBase(m_feedback[i], 0, m_state[i].id());
+            } else {
+                glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_feedback[i]);
+                glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_state[i].id());
+            }
+        }
+        if (!dsa_enabled) {
+            if (GLAD_GL_VERSION_4_0) glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+            m_update[0].unuse();
+        }
+        logDebug("Created particle system: %d particles (%s)", m_capacity, GLAD_GL_VERSION_4_0 ? "feedback objects" : "default feedback");
+    }
+
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    // Queues particles for the next step(), replacing the oldest slots.
+    // Only the last `capacity` particles of a batch survive.
+    inline ParticleSystem& emit(std::span<const Particle> particles) {
+        m_stats.emitted += particles.size();
+        if (particles.size() > m_capacity) {
+            m_head = (m_head + particles.size() - m_capacity) % m_capacity;
+            particles = particles.last(m_capacity);
+        }
+        // The pending run must not lap itself
+        if (m_pending.size() + particles.size() > m_capacity) flushEmits();
+        if (m_pending.empty()) m_pendingSlot = m_head;
+        m_pending.insert(m_pending.end(), particles.begin(), particles.end());
+        m_head = (m_head + particles.size()) % m_capacity;
+        return *this;
+    }
+
+    inline ParticleSystem& emit(const Particle& particle) {
+        return emit(std::span<const Particle>(&particle, 1));
+    }
+
+    // Advances every particle once with `update` (compiled with varyings);
+    // deltaTime is set here, other uniforms are the caller's
+    inline ParticleSystem& step(Shader& update, float deltaTime) {
+        flushEmits();
+        u32 next = 1 - m_current;
+        update.use();
+        update.uniform("deltaTime", deltaTime);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        m_update[m_current].use();
+        if (m_feedback[next]) glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_feedback[next]);
+        else glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_state[next].id());
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, m_capacity);
+        glEndTransformFeedback();
+        if (m_feedback[next]) glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+        else glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        m_update[m_current].unuse();
+
+        touchMemory(ResourceKind::Buffer, m_state[m_current].id());
+        touchMemory(ResourceKind::Buffer, m_state[next].id());
+        m_current = next;
+        m_stats.steps++;
+        return *this;
+    }
+
+    // One square per particle; the render shader places its corners from
+    // gl_VertexID
+    inline ParticleSystem& draw(Shader& render) {
+        flushEmits();
+        render.use();
+        m_render[m_current].use();
+        drawSquareInstanced(m_capacity);
+        m_render[m_current].unuse();
+        touchMemory(ResourceKind::Buffer, m_state[m_current].id());
+        return *this;
+    }
+
+    inline u32 capacity() const { return m_capacity; }
+
+    // Buffer holding the latest state, e.g. to link into other VAOs
+    inline Buffer& state() { return m_state[m_current]; }
+
+    inline const ParticleStats& stats() const {
+        return m_stats;
+    }
+
+    inline void resetStats() {
+        m_stats = {};
+    }
+
+    inline ~ParticleSystem() {
+        for (u32 feedback : m_feedback) {
+            if (feedback) deleteName(ResourceKind::TransformFeedback, feedback);
+        }
+        logDebug("Destroyed particle system");
+    }
+};
+
+};
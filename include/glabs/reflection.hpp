@@ -0,0 +1,110 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+
+namespace GL {
+
+// Flat snapshot of a linked program's interface, captured once after link so
+// lookups never go back to the driver
+struct ShaderReflection {
+    struct Variable {
+        char name[64];
+        u32 type;
+        i32 size;
+        i32 location;
+    };
+
+    struct Block {
+        char name[64];
+        u32 index;
+        i32 dataSize;
+        i32 binding;
+    };
+
+    std::vector<Variable> attributes; // In active index order
+    std::vector<Variable> uniforms;
+    std::vector<Block> blocks;
+
+    inline void capture(u32 program) {
+        attributes.clear();
+        uniforms.clear();
+        blocks.clear();
+
+        GLint count {};
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        attributes.resize(count);
+        for (i32 i {}; i < count; i++) {
+            Variable& v = attributes[i];
+            glGetActiveAttrib(program, i, sizeof(v.name), nullptr, &v.size, &v.type, v.name);
+            v.location = glGetAttribLocation(program, v.name);
+            logDebug("%s index: %d size: %d location: %d", v.name, i, v.size, v.location);
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        uniforms.resize(count);
+        for (i32 i {}; i < count; i++) {
+            Variable& v = uniforms[i];
+            glGetActiveUniform(program, i, sizeof(v.name), nullptr, &v.size, &v.type, v.name);
+            v.location = glGetUniformLocation(program, v.name);
+            // Arrays are reported as "name[0]"; store the base name. Only a
+            // trailing [0] goes, so "lights[0].color" keeps its full name.
+            u64 length = std::strlen(v.name);
+            if (length > 3 && std::strcmp(v.name + length - 3, "[0]") == 0) v.name[length - 3] = '\0';
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        blocks.resize(count);
+        for (i32 i {}; i < count; i++) {
+            Block& b = blocks[i];
+            b.index = i;
+            glGetActiveUniformBlockName(program, i, sizeof(b.name), nullptr, b.name);
+            glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &b.dataSize);
+            glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &b.binding);
+        }
+    }
+
+    inline const Variable* attribute(const char* name) const {
+        return find(attributes, name);
+    }
+
+    inline const Variable* uniform(const char* name) const {
+        return find(uniforms, name);
+    }
+
+    inline const Block* block(const char* name) const {
+        return find(blocks, name);
+    }
+
+private:
+    template<typename V>
+    static inline const V* find(const std::vector<V>& vars, const char* name) {
+        for (auto& v : vars) {
+            if (std::strcmp(v.name, name) == 0) return &v;
+        }
+        return nullptr;
+    }
+};
+
+// Number of float components of a GLSL float vector type, 0 otherwise
+constexpr u32 floatComponents(u32 type) {
+    switch (type) {
+    case GL_FLOAT: return 1;
+    case GL_FLOAT_VEC2: return 2;
+    case GL_FLOAT_VEC3: return 3;
+    case GL_FLOAT_VEC4: return 4;
+    default: return 0;
+    }
+}
+
+// A vertex input accepts its exact type, or a wider float vector (missing
+// components are filled in by the fetch)
+constexpr bool attribCompatible(u32 provided, u32 declared) {
+    if (provided == declared) return true;
+    u32 p = floatComponents(provided);
+    return p && p <= floatComponents(declared);
+}
+
+};
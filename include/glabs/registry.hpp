@@ -0,0 +1,369 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/error.hpp>
+
+#include "backend.hpp"
+
+namespace GL {
+
+enum class ResourceKind : u8 {
+    Buffer,
+    VertexArray,
+    Framebuffer,
+    Texture,
+    Program,
+    TransformFeedback,
+    Query,
+    Count
+};
+
+static_assert(static_cast<u32>(ResourceKind::Count) <= 8, "Handle keeps the kind in 3 bits");
+
+// 32-bit generational handle: [kind:3][generation:9][slot:20]. A handle goes
+// stale as soon as its slot is destroyed, even after the slot is reused.
+struct Handle {
+    u32 value {};
+
+    static constexpr u32 slotBits = 20;
+    static constexpr u32 generationBits = 9;
+
+    static constexpr Handle make(ResourceKind kind, u32 generation, u32 slot) {
+        return {(static_cast<u32>(kind) << (slotBits + generationBits)) | (generation << slotBits) | slot};
+    }
+
+    constexpr u32 slot() const { return value & ((1u << slotBits) - 1); }
+    constexpr u32 generation() const { return (value >> slotBits) & ((1u << generationBits) - 1); }
+    constexpr ResourceKind kind() const { return static_cast<ResourceKind>(value >> (slotBits + generationBits)); }
+    constexpr explicit operator bool() const { return value != 0; }
+    constexpr bool operator==(const Handle&) const = default;
+};
+
+struct RegistryStats {
+    u32 generated {};   // names created through glGen*/glCreate*
+    u32 deleted {};     // names returned to the driver
+    u32 genCalls {};
+    u32 deleteCalls {};
+    u32 pending {};     // released, waiting for their frame's fence
+};
+
+// Hands out GL names from pre-generated blocks and defers deletion until the
+// GPU is done with the frame that released them. The context thread is the
+// one that constructed the registry (see setContextThread); only it issues
+// GL calls, so endFrame/collect/flush/reserve must run there.
+// acquire/release/create/destroy may be called from any thread, but only the
+// context thread generates names when a pool runs dry: other threads draw on
+// what reserve() set aside and abort when it is exhausted. endFrame tops the
+// reserves back up.
+class ResourceRegistry {
+    static constexpr u32 kinds = static_cast<u32>(ResourceKind::Count);
+
+    struct Slot {
+        u32 name;
+        u16 generation;
+    };
+
+    struct Batch {
+        GLsync fence;
+        std::vector<u32> names[kinds];
+    };
+
+    std::mutex m_mutex;
+    u32 m_block;
+    std::vector<u32> m_pool[kinds];
+    std::vector<Slot> m_slots[kinds];
+    std::vector<u32> m_freeSlots[kinds];
+    std::vector<u32> m_released[kinds];
+    u32 m_reserve[kinds] {};
+    std::deque<Batch> m_batches;
+    std::thread::id m_contextThread {std::this_thread::get_id()};
+    RegistryStats m_stats;
+
+    static inline void generate(ResourceKind kind, u32 n, u32* names) {
+        if (dsa_enabled) {
+            create(kind, n, names);
+            return;
+        }
+        switch (kind) {
+        case ResourceKind::Buffer:      glGenBuffers(n, names); break;
+        case ResourceKind::VertexArray: glGenVertexArrays(n, names); break;
+        case ResourceKind::Framebuffer: glGenFramebuffers(n, names); break;
+        case ResourceKind::Texture:     glGenTextures(n, names); break;
+        case ResourceKind::Program:
+            for (u32 i {}; i < n; i++) names[i] = glCreateProgram();
+            break;
+        case ResourceKind::TransformFeedback: glGenTransformFeedbacks(n, names); break;
+        case ResourceKind::Query:       glGenQueries(n, names); break;
+        default: break;
+        }
+    }
+
+public:
+    // Creates n initialized objects, as DSA requires. A texture's target is
+    // fixed at creation, so textures only get names here; see genTextureName.
+    // Queries too: a name takes its target at the first glBeginQuery.
+    static inline void create(ResourceKind kind, u32 n, u32* names) {
+        switch (kind) {
+        case ResourceKind::Buffer:      glCreateBuffers(n, names); break;
+        case ResourceKind::VertexArray: glCreateVertexArrays(n, names); break;
+        case ResourceKind::Framebuffer: glCreateFramebuffers(n, names); break;
+        case ResourceKind::Texture:     glGenTextures(n, names); break;
+        case ResourceKind::Program:
+            for (u32 i {}; i < n; i++) names[i] = glCreateProgram();
+            break;
+        case ResourceKind::TransformFeedback: glCreateTransformFeedbacks(n, names); break;
+        case ResourceKind::Query:       glGenQueries(n, names); break;
+        default: break;
+        }
+    }
+
+private:
+    static inline void remove(ResourceKind kind, u32 n, const u32* names) {
+        switch (kind) {
+        case ResourceKind::Buffer:      glDeleteBuffers(n, names); break;
+        case ResourceKind::VertexArray: glDeleteVertexArrays(n, names); break;
+        case ResourceKind::Framebuffer: glDeleteFramebuffers(n, names); break;
+        case ResourceKind::Texture:     glDeleteTextures(n, names); break;
+        case ResourceKind::Program:
+            for (u32 i {}; i < n; i++) glDeleteProgram(names[i]);
+            break;
+        case ResourceKind::TransformFeedback: glDeleteTransformFeedbacks(n, names); break;
+        case ResourceKind::Query:       glDeleteQueries(n, names); break;
+        default: break;
+        }
+    }
+
+    inline void deleteBatch(Batch& batch) {
+        for (u32 k {}; k < kinds; k++) {
+            auto& names = batch.names[k];
+            if (names.empty()) continue;
+            remove(static_cast<ResourceKind>(k), names.size(), names.data());
+            m_stats.deleted += names.size();
+            m_stats.pending -= names.size();
+            m_stats.deleteCalls++;
+        }
+        if (batch.fence) glDeleteSync(batch.fence);
+    }
+
+    inline void refillLocked(ResourceKind kind, u32 n) {
+        auto& pool = m_pool[static_cast<u32>(kind)];
+        u32 size = pool.size();
+        pool.resize(size + n);
+        generate(kind, n, pool.data() + size);
+        m_stats.generated += n;
+        m_stats.genCalls++;
+    }
+
+    inline u32 acquireLocked(ResourceKind kind) {
+        auto& pool = m_pool[static_cast<u32>(kind)];
+        if (pool.empty()) {
+            if (std::this_thread::get_id() != m_contextThread) {
+                abort("ResourceRegistry: pool empty off the context thread; reserve() more names");
+            }
+            // Programs are created one call at a time, so don't batch them
+            refillLocked(kind, kind == ResourceKind::Program ? 1 : m_block);
+        }
+        u32 name = pool.back();
+        pool.pop_back();
+        return name;
+    }
+
+    inline void releaseLocked(ResourceKind kind, u32 name) {
+        m_released[static_cast<u32>(kind)].push_back(name);
+        m_stats.pending++;
+    }
+
+public:
+    inline ResourceRegistry(u32 block = 256) : m_block(block) {
+
+    }
+
+    ResourceRegistry(const ResourceRegistry&) = delete;
+    ResourceRegistry& operator=(const ResourceRegistry&) = delete;
+
+    inline ~ResourceRegistry() {
+        flush();
+        for (u32 k {}; k < kinds; k++) {
+            auto& pool = m_pool[k];
+            if (!pool.empty()) remove(static_cast<ResourceKind>(k), pool.size(), pool.data());
+        }
+    }
+
+    // Makes the calling thread the one whose context generates and deletes
+    // names, e.g. when the render context moves to another thread
+    inline void setContextThread() {
+        std::lock_guard lock(m_mutex);
+        m_contextThread = std::this_thread::get_id();
+    }
+
+    // Context thread: keeps at least `count` names of a kind pooled for
+    // threads without the context, now and after every endFrame(). Container
+    // kinds (VertexArray, Framebuffer, TransformFeedback) are not shared
+    // between contexts, so reserve them only for use on the context thread.
+    inline void reserve(ResourceKind kind, u32 count) {
+        std::lock_guard lock(m_mutex);
+        u32 k = static_cast<u32>(kind);
+        m_reserve[k] = count;
+        if (m_pool[k].size() < count) refillLocked(kind, count - m_pool[k].size());
+    }
+
+    // Raw names, for the object wrappers
+    inline u32 acquire(ResourceKind kind) {
+        std::lock_guard lock(m_mutex);
+        return acquireLocked(kind);
+    }
+
+    inline void release(ResourceKind kind, u32 name) {
+        if (!name) return;
+        std::lock_guard lock(m_mutex);
+        releaseLocked(kind, name);
+    }
+
+    inline Handle create(ResourceKind kind) {
+        std::lock_guard lock(m_mutex);
+        u32 k = static_cast<u32>(kind);
+        u32 name = acquireLocked(kind);
+        u32 slot;
+        if (!m_freeSlots[k].empty()) {
+            slot = m_freeSlots[k].back();
+            m_freeSlots[k].pop_back();
+            m_slots[k][slot].name = name;
+        } else {
+            slot = m_slots[k].size();
+            if (slot >= 1u << Handle::slotBits) {
+                abort("ResourceRegistry: out of handle slots");
+            }
+            m_slots[k].push_back({name, 1});
+        }
+        return Handle::make(kind, m_slots[k][slot].generation, slot);
+    }
+
+    inline void destroy(Handle handle) {
+        std::lock_guard lock(m_mutex);
+        u32 k = static_cast<u32>(handle.kind());
+        if (!handle || k >= kinds || handle.slot() >= m_slots[k].size()) return;
+        Slot& slot = m_slots[k][handle.slot()];
+        if (slot.generation != handle.generation()) return;
+
+        releaseLocked(handle.kind(), slot.name);
+        slot.name = 0;
+        // Generation 0 is never handed out, so a zero handle is always invalid
+        u32 next = slot.generation + 1u;
+        slot.generation = next < (1u << Handle::generationBits) ? next : 1;
+        m_freeSlots[k].push_back(handle.slot());
+    }
+
+    // GL name behind a handle, 0 when stale
+    inline u32 name(Handle handle) {
+        std::lock_guard lock(m_mutex);
+        u32 k = static_cast<u32>(handle.kind());
+        if (!handle || k >= kinds || handle.slot() >= m_slots[k].size()) return 0;
+        const Slot& slot = m_slots[k][handle.slot()];
+        return slot.generation == handle.generation() ? slot.name : 0;
+    }
+
+    inline bool valid(Handle handle) {
+        return name(handle) != 0;
+    }
+
+    // Closes the current frame: everything released so far is deleted once
+    // the commands issued up to here have completed
+    inline void endFrame() {
+        std::lock_guard lock(m_mutex);
+        for (u32 k {}; k < kinds; k++) {
+            if (m_pool[k].size() < m_reserve[k]) refillLocked(static_cast<ResourceKind>(k), m_reserve[k] - m_pool[k].size());
+        }
+        Batch batch {};
+        bool any {};
+        for (u32 k {}; k < kinds; k++) {
+            any |= !m_released[k].empty();
+            batch.names[k].swap(m_released[k]);
+        }
+        if (!any) return;
+        batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_batches.push_back(std::move(batch));
+    }
+
+    // Deletes the batches whose fence has signaled, without waiting
+    inline void collect() {
+        std::lock_guard lock(m_mutex);
+        while (!m_batches.empty()) {
+            GLenum status = glClientWaitSync(m_batches.front().fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+            deleteBatch(m_batches.front());
+            m_batches.pop_front();
+        }
+    }
+
+    // Deletes everything pending now, e.g. on shutdown or level unload
+    inline void flush() {
+        std::lock_guard lock(m_mutex);
+        for (auto& batch : m_batches) deleteBatch(batch);
+        m_batches.clear();
+        Batch batch {};
+        for (u32 k {}; k < kinds; k++) batch.names[k].swap(m_released[k]);
+        deleteBatch(batch);
+    }
+
+    inline RegistryStats stats() {
+        std::lock_guard lock(m_mutex);
+        return m_stats;
+    }
+};
+
+// When set, object wrappers take their names from the registry and defer
+// their deletion through it
+inline ResourceRegistry* resource_registry {};
+
+inline u32 genName(ResourceKind kind) {
+    if (resource_registry) return resource_registry->acquire(kind);
+    u32 name {};
+    if (dsa_enabled) {
+        ResourceRegistry::create(kind, 1, &name);
+        return name;
+    }
+    switch (kind) {
+    case ResourceKind::Buffer:      glGenBuffers(1, &name); break;
+    case ResourceKind::VertexArray: glGenVertexArrays(1, &name); break;
+    case ResourceKind::Framebuffer: glGenFramebuffers(1, &name); break;
+    case ResourceKind::Texture:     glGenTextures(1, &name); break;
+    case ResourceKind::Program:     name = glCreateProgram(); break;
+    case ResourceKind::TransformFeedback: glGenTransformFeedbacks(1, &name); break;
+    case ResourceKind::Query:       glGenQueries(1, &name); break;
+    default: break;
+    }
+    return name;
+}
+
+// Under DSA the texture object is created with its target right away, outside
+// the registry's pre-generated pool; deletion still goes through deleteName
+inline u32 genTextureName(u32 target) {
+    if (!dsa_enabled) return genName(ResourceKind::Texture);
+    u32 name {};
+    glCreateTextures(target, 1, &name);
+    return name;
+}
+
+inline void deleteName(ResourceKind kind, u32 name) {
+    if (resource_registry) {
+        resource_registry->release(kind, name);
+        return;
+    }
+    switch (kind) {
+    case ResourceKind::Buffer:      glDeleteBuffers(1, &name); break;
+    case ResourceKind::VertexArray: glDeleteVertexArrays(1, &name); break;
+    case ResourceKind::Framebuffer: glDeleteFramebuffers(1, &name); break;
+    case ResourceKind::Texture:     glDeleteTextures(1, &name); break;
+    case ResourceKind::Program:     glDeleteProgram(name); break;
+    case ResourceKind::TransformFeedback: glDeleteTransformFeedbacks(1, &name); break;
+    case ResourceKind::Query:       glDeleteQueries(1, &name); break;
+    default: break;
+    }
+}
+
+};
@@ -5,9 +5,16 @@
 #include <glad/glad.h>
 #include <cpputils/types.hpp>
 #include <cpputils/error.hpp>
+#include <vector>
+#include <span>
+#include <string>
+#include <utility>
+#include <cstdio>
 
 #include "color.hpp"
 #include "vbo.hpp"
+#include "reflection.hpp"
+#include "registry.hpp"
 
 namespace GL {
 
@@ -16,13 +23,60 @@ struct RGBA;
 inline Shader* current_shader {};
 
 class Shader {
+    struct AttribPlanEntry {
+        const void* key;
+        std::vector<i32> locations;     // -1 where the element failed
+        std::vector<std::string> errors; // Per element, empty when it matched
+    };
+
+    template<typename Tupl>
+    const AttribPlanEntry& buildAttribPlan();
+
     u32 m_program {};
     const char* m_vSource;
     const char* m_fSource;
+    ShaderReflection m_reflection;
+    std::vector<AttribPlanEntry> m_attribPlans;
+    std::vector<const char*> m_feedbackVaryings;
+    u32 m_feedbackMode {GL_INTERLEAVED_ATTRIBS};
 
 public:
     inline Shader(const char* vsource, const char* fsource) : m_vSource(vsource), m_fSource(fsource) {
-        m_program = glCreateProgram();
+        m_program = genName(ResourceKind::Program);
+    }
+
+    // Owns its program: moves hand it over, copies would delete it twice
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    inline Shader(Shader&& other)
+        : m_program(std::exchange(other.m_program, 0)), m_vSource(other.m_vSource), m_fSource(other.m_fSource),
+          m_reflection(std::move(other.m_reflection)), m_attribPlans(std::move(other.m_attribPlans)),
+          m_feedbackVaryings(std::move(other.m_feedbackVaryings)), m_feedbackMode(other.m_feedbackMode) {
+        if (current_shader == &other) current_shader = this;
+    }
+
+    inline Shader& operator=(Shader&& other) {
+        std::swap(m_program, other.m_program);
+        std::swap(m_vSource, other.m_vSource);
+        std::swap(m_fSource, other.m_fSource);
+        std::swap(m_reflection, other.m_reflection);
+        std::swap(m_attribPlans, other.m_attribPlans);
+        std::swap(m_feedbackVaryings, other.m_feedbackVaryings);
+        std::swap(m_feedbackMode, other.m_feedbackMode);
+        // The bound program moved along with its name
+        if (current_shader == &other) current_shader = this;
+        else if (current_shader == this) current_shader = &other;
+        return *this;
+    }
+
+    // Vertex outputs captured by transform feedback; takes effect at the next
+    // compile(), since the list is fixed when the program links. The strings
+    // must outlive that call.
+    inline Shader& feedbackVaryings(std::span<const char* const> names, u32 mode = GL_INTERLEAVED_ATTRIBS) {
+        m_feedbackVaryings.assign(names.begin(), names.end());
+        m_feedbackMode = mode;
+        return *this;
     }
 
     inline Shader& compile() {
@@ -51,22 +105,16 @@ public:
         // Link shaders
         glAttachShader(m_program, m_vs);
         glAttachShader(m_program, m_fs);
+        if (!m_feedbackVaryings.empty()) {
+            glTransformFeedbackVaryings(m_program, m_feedbackVaryings.size(), m_feedbackVaryings.data(), m_feedbackMode);
+        }
         glLinkProgram(m_program);
 
         glDeleteShader(m_vs);
         glDeleteShader(m_fs);
 
-        GLint count;
-        glGetProgramiv(m_program, GL_ACTIVE_ATTRIBUTES, &count);
-        for (int i {}; i < count; i++) {
-            char name[16];
-            GLenum type;
-            int size;
-            int length;
-            glGetActiveAttrib(m_program, (GLuint)i, sizeof(name), &length, &size, &type, name);
-            int location = glGetAttribLocation(m_program, name);
-            logDebug("%s index: %d size: %d location: %d", name, i, size, location);
-        }
+        m_reflection.capture(m_program);
+        m_attribPlans.clear();
 
         return *this;
     }
@@ -91,81 +139,150 @@ public:
     }
 
     inline u32 indexToLocation(u32 index) {
-        char name[16] {};
-        GLenum type;
-        GLint size;
-        GLsizei length;
-
-        glGetActiveAttrib(m_program, index, sizeof(name), &length, &size, &type, name);
-        u32 location = glGetAttribLocation(m_program, name);
-        logDebug("Index to location %d -> %d [%s]", index, location, name);
-        return location;
+        if (index >= m_reflection.attributes.size()) {
+            logDebug("Index to location %d -> not active", index);
+            return -1;
+        }
+        auto& attrib = m_reflection.attributes[index];
+        logDebug("Index to location %d -> %d [%s]", index, attrib.location, attrib.name);
+        return attrib.location;
     }
 
     inline u32 getAttribLocation(const char* name) const {
-        return glGetAttribLocation(m_program, name);
+        auto* attrib = m_reflection.attribute(name);
+        return attrib ? attrib->location : -1;
+    }
+
+    inline i32 uniformLocation(const char* name) const {
+        auto* u = m_reflection.uniform(name);
+        return u ? u->location : glGetUniformLocation(m_program, name);
     }
+
+    inline const ShaderReflection& reflection() const {
+        return m_reflection;
+    }
+
+    // Locations for each element of Tupl, validated against the reflected
+    // attribute table once and replayed afterwards. Element i must match the
+    // active attribute with index i; a missing attribute or incompatible
+    // type aborts instead of linking the wrong data. Only elements from
+    // `first` on are checked, so a chain may skip the ones that don't match.
+    template<typename Tupl>
+    const i32* attribPlan(u32 first = 0);
+
+    // Location of one element, aborting only when that element failed
+    template<typename Tupl>
+    i32 attribLocation(u32 element);
+
+    // Why element `element` (or the first failing one) can't be linked,
+    // nullptr when it can
+    template<typename Tupl>
+    const char* attribPlanError(u32 element);
+    template<typename Tupl>
+    const char* attribPlanError();
     
     inline Shader& uniform(const char* name, int v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniform1i(location, v);
         return *this;
     }
 
     inline Shader& uniform(const char* name, const Vec2& v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniform2fv(location, 1, reinterpret_cast<const float*>(&v));
         return *this;
     }
 
     inline Shader& uniform(const char* name, const Vec3& v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniform3fv(location, 1, reinterpret_cast<const float*>(&v));
         return *this;
     }
 
     inline Shader& uniform(const char* name, const Vec4& v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniform4fv(location, 1, reinterpret_cast<const float*>(&v));
         return *this;
     }
 
     inline Shader& uniform(const char* name, const Mat4& v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniformMatrix4fv(location, 1, GL_FALSE, reinterpret_cast<const float*>(&v));
         return *this;
     }
     inline Shader& uniform(const char* name, const Mat3& v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniformMatrix3fv(location, 1, GL_FALSE, reinterpret_cast<const float*>(&v));
         return *this;
     }
     Shader& uniform(const char* name, const uVec2& v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniform2uiv(location, 1, reinterpret_cast<const u32*>(&v));
         return *this;
     }
     Shader& uniform(const char* name, const RGBA c) {
-        Vec4 color {c.r/255.f, c.g/255.f, c.b/255.f, c.a/255.f};
-        uniform(name, color);
+        uniform(name, rgbaToFloat4(c));
         return *this;
     }
     Shader& uniform(const char* name, float v) {
-        int location = glGetUniformLocation(m_program, name);
+        int location = uniformLocation(name);
         glUniform1f(location, v);
         return *this;
     }
+
+    // Arrays: one lookup and one call for the whole span. name is the array
+    // itself ("bones" or "bones[0]"), elements past its size are ignored.
+    inline Shader& uniform(const char* name, std::span<const int> v) {
+        glUniform1iv(uniformLocation(name), v.size(), v.data());
+        return *this;
+    }
+
+    inline Shader& uniform(const char* name, std::span<const float> v) {
+        glUniform1fv(uniformLocation(name), v.size(), v.data());
+        return *this;
+    }
+
+    inline Shader& uniform(const char* name, std::span<const Vec2> v) {
+        glUniform2fv(uniformLocation(name), v.size(), reinterpret_cast<const float*>(v.data()));
+        return *this;
+    }
+
+    inline Shader& uniform(const char* name, std::span<const Vec3> v) {
+        glUniform3fv(uniformLocation(name), v.size(), reinterpret_cast<const float*>(v.data()));
+        return *this;
+    }
+
+    inline Shader& uniform(const char* name, std::span<const Vec4> v) {
+        glUniform4fv(uniformLocation(name), v.size(), reinterpret_cast<const float*>(v.data()));
+        return *this;
+    }
+
+    inline Shader& uniform(const char* name, std::span<const Mat3> v) {
+        glUniformMatrix3fv(uniformLocation(name), v.size(), GL_FALSE, reinterpret_cast<const float*>(v.data()));
+        return *this;
+    }
+
+    inline Shader& uniform(const char* name, std::span<const Mat4> v) {
+        glUniformMatrix4fv(uniformLocation(name), v.size(), GL_FALSE, reinterpret_cast<const float*>(v.data()));
+        return *this;
+    }
     
+    // Validates the attribute plan for the VBO's tuple up front. Linking by
+    // name stays possible with any order; autoLink* aborts on a failed plan.
     template<u32 s = 0, typename... Ts>
     auto attribLinker(VBO<Ts...>& vbo);
 
+    template<u32 s = 0, typename... Ts>
+    auto attribLinker(SoAVBO<Ts...>& vbo);
+
     u32 getProgram() const;
     u32 getAttrib(const char* name) const {
-        return glGetAttribLocation(m_program, name);
+        return getAttribLocation(name);
     }
     
     ~Shader() {
-        glDeleteProgram(m_program);
+        if (current_shader == this) current_shader = nullptr;
+        if (m_program) deleteName(ResourceKind::Program, m_program);
     }
 };
 
@@ -175,10 +292,81 @@ public:
 
 namespace GL {
 
+template<typename Tupl>
+inline const Shader::AttribPlanEntry& Shader::buildAttribPlan() {
+    static constexpr char key {};
+    for (auto& plan : m_attribPlans) {
+        if (plan.key == &key) return plan;
+    }
+
+    auto& plan = m_attribPlans.emplace_back(AttribPlanEntry{&key, std::vector<i32>(TupleSize<Tupl>, -1), std::vector<std::string>(TupleSize<Tupl>)});
+    constexpr_for(u32 i=0, i<TupleSize<Tupl>, i+1,
+        using iT = TupleElement<i, Tupl>;
+        char error[128] {};
+        if (i >= m_reflection.attributes.size()) {
+            std::snprintf(error, sizeof(error), "Attribute plan: element %u has no active attribute", u32(i));
+        } else {
+            auto& attrib = m_reflection.attributes[i];
+            if (glslType<iT> && !attribCompatible(glslType<iT>, attrib.type)) {
+                std::snprintf(error, sizeof(error), "Attribute plan: element %u does not match %s (type 0x%x)", u32(i), attrib.name, attrib.type);
+            } else {
+                plan.locations[i] = attrib.location;
+            }
+        }
+        if (error[0]) {
+            logDebug("%s", error);
+            plan.errors[i] = error;
+        }
+    );
+    return plan;
+}
+
+template<typename Tupl>
+inline const i32* Shader::attribPlan(u32 first) {
+    auto& plan = buildAttribPlan<Tupl>();
+    for (u32 i = first; i < plan.errors.size(); i++) {
+        if (!plan.errors[i].empty()) abort(plan.errors[i].c_str());
+    }
+    return plan.locations.data();
+}
+
+template<typename Tupl>
+inline i32 Shader::attribLocation(u32 element) {
+    auto& plan = buildAttribPlan<Tupl>();
+    if (!plan.errors[element].empty()) abort(plan.errors[element].c_str());
+    return plan.locations[element];
+}
+
+template<typename Tupl>
+inline const char* Shader::attribPlanError(u32 element) {
+    auto& plan = buildAttribPlan<Tupl>();
+    return plan.errors[element].empty() ? nullptr : plan.errors[element].c_str();
+}
+
+template<typename Tupl>
+inline const char* Shader::attribPlanError() {
+    auto& plan = buildAttribPlan<Tupl>();
+    for (auto& error : plan.errors) {
+        if (!error.empty()) return error.c_str();
+    }
+    return nullptr;
+}
+
+inline u32 Shader::getProgram() const {
+    return m_program;
+}
+
 template<u32 s, typename... Ts>
 inline auto Shader::attribLinker(VBO<Ts...>& vbo) {
+    buildAttribPlan<Tuple<Ts...>>();
     vbo.use();
     return AttribLinker<s, Tuple<Ts...>>{*this};
 }
 
+template<u32 s, typename... Ts>
+inline auto Shader::attribLinker(SoAVBO<Ts...>& vbo) {
+    buildAttribPlan<Tuple<Ts...>>();
+    return AttribLinker<s, Tuple<Ts...>, true>{*this, vbo.ids()};
+}
+
 };
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <initializer_list>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/error.hpp>
+
+#include "shader.hpp"
+#include "hash.hpp"
+
+namespace GL {
+
+// Permutations of one vertex/fragment pair. Bit i of a feature mask emits
+// "#define <features[i]> 1" right after the #version line. Variants are
+// compiled on first request and shared between masks that preprocess to the
+// same sources, e.g. masks that only differ in features the sources never
+// mention.
+class ShaderLibrary {
+    struct Variant {
+        std::string vSource;
+        std::string fSource;
+        std::unique_ptr<Shader> shader;
+    };
+
+    std::string m_vSource;
+    std::string m_fSource;
+    std::vector<std::string> m_features;
+    u64 m_usedMask {};
+
+    std::unordered_map<u64, Shader*> m_byMask;
+    // Variants whose preprocessed sources share a hash; more than one only
+    // on a collision
+    std::unordered_map<u64, std::vector<std::unique_ptr<Variant>>> m_byHash;
+    std::size_t m_programs {};
+
+    inline std::string preprocess(const std::string& source, u64 mask) const {
+        std::string defines;
+        for (u32 i {}; i < m_features.size(); i++) {
+            if (mask & (1ull << i)) {
+                defines += "#define ";
+                defines += m_features[i];
+                defines += " 1\n";
+            }
+        }
+
+        std::size_t at {};
+        std::size_t version = source.find("#version");
+        if (version != std::string::npos) {
+            at = source.find('\n', version);
+            at = at == std::string::npos ? source.size() : at + 1;
+        }
+        std::string out;
+        out.reserve(source.size() + defines.size());
+        out.append(source, 0, at);
+        out += defines;
+        out.append(source, at);
+        return out;
+    }
+
+public:
+    inline ShaderLibrary(const char* vsource, const char* fsource, std::initializer_list<const char*> features)
+        : m_vSource(vsource), m_fSource(fsource) {
+        if (features.size() > 64) {
+            abort("ShaderLibrary supports at most 64 features");
+        }
+        for (const char* f : features) {
+            u32 bit = m_features.size();
+            m_features.emplace_back(f);
+            if (m_vSource.find(f) != std::string::npos || m_fSource.find(f) != std::string::npos) {
+                m_usedMask |= 1ull << bit;
+            }
+        }
+    }
+
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    inline u64 feature(const char* name) const {
+        for (u32 i {}; i < m_features.size(); i++) {
+            if (m_features[i] == name) return 1ull << i;
+        }
+        logDebug("ShaderLibrary: unknown feature %s", name);
+        return 0;
+    }
+
+    inline Shader& get(u64 mask) {
+        if (auto it = m_byMask.find(mask); it != m_byMask.end()) {
+            return *it->second;
+        }
+
+        u64 relevant = mask & m_usedMask;
+        std::string vs = preprocess(m_vSource, relevant);
+        std::string fs = preprocess(m_fSource, relevant);
+        u64 hash = hash64(fs.data(), fs.size(), hash64(vs.data(), vs.size()));
+
+        // The hash only narrows the search; the sources decide
+        auto& bucket = m_byHash[hash];
+        Variant* variant {};
+        for (auto& v : bucket) {
+            if (v->vSource == vs && v->fSource == fs) {
+                variant = v.get();
+                break;
+            }
+        }
+        if (!variant) {
+            if (!bucket.empty()) logDebug("ShaderLibrary: hash collision on %llx", (unsigned long long) hash);
+            variant = bucket.emplace_back(std::make_unique<Variant>(Variant{std::move(vs), std::move(fs), nullptr})).get();
+            variant->shader = std::make_unique<Shader>(variant->vSource.c_str(), variant->fSource.c_str());
+            variant->shader->compile();
+            m_programs++;
+            logDebug("ShaderLibrary: compiled variant %llx (hash %llx)", (unsigned long long) relevant, (unsigned long long) hash);
+        }
+
+        Shader* shader = variant->shader.get();
+        m_byMask.emplace(mask, shader);
+        return *shader;
+    }
+
+    // Compiles the given variants now instead of on first use
+    inline ShaderLibrary& prewarm(std::span<const u64> masks) {
+        for (u64 mask : masks) get(mask);
+        return *this;
+    }
+
+    inline std::size_t programCount() const {
+        return m_programs;
+    }
+
+    inline u64 usedFeatures() const {
+        return m_usedMask;
+    }
+};
+
+};
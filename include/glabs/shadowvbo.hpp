@@ -0,0 +1,226 @@
+#pragma once
+#include <type_traits>
+#include <vector>
+#include <span>
+#include <cstring>
+#include <algorithm>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/tuple.hpp>
+#include <cpputils/metafunctions.hpp>
+
+#include "vbo.hpp"
+
+namespace GL {
+
+// Sorted, disjoint byte ranges [begin, end). Touching or overlapping
+// ranges are merged on insertion.
+class DirtyRanges {
+public:
+    struct Range {
+        u32 begin;
+        u32 end;
+    };
+
+private:
+    std::vector<Range> m_ranges;
+
+public:
+    inline void add(u32 begin, u32 end) {
+        if (begin >= end) return;
+
+        // Sequential writes are the common case
+        if (m_ranges.empty() || m_ranges.back().end < begin) {
+            m_ranges.push_back({begin, end});
+            return;
+        }
+
+        auto first = std::lower_bound(m_ranges.begin(), m_ranges.end(), begin, [](const Range& r, u32 b) {
+            return r.end < b;
+        });
+        auto last = first;
+        while (last != m_ranges.end() && last->begin <= end) {
+            begin = std::min(begin, last->begin);
+            end = std::max(end, last->end);
+            ++last;
+        }
+        if (first == last) {
+            m_ranges.insert(first, {begin, end});
+        } else {
+            *first = {begin, end};
+            m_ranges.erase(first + 1, last);
+        }
+    }
+
+    // Merges ranges separated by at most gap bytes: re-uploading a small
+    // clean hole is cheaper than another call
+    inline void coalesce(u32 gap) {
+        if (m_ranges.size() < 2) return;
+        std::size_t out {};
+        for (std::size_t i = 1; i < m_ranges.size(); i++) {
+            if (m_ranges[i].begin - m_ranges[out].end <= gap) {
+                m_ranges[out].end = m_ranges[i].end;
+            } else {
+                m_ranges[++out] = m_ranges[i];
+            }
+        }
+        m_ranges.resize(out + 1);
+    }
+
+    inline u32 bytes() const {
+        u32 total {};
+        for (auto& r : m_ranges) total += r.end - r.begin;
+        return total;
+    }
+
+    inline std::size_t size() const { return m_ranges.size(); }
+    inline bool empty() const { return m_ranges.empty(); }
+    inline void clear() { m_ranges.clear(); }
+    inline auto begin() const { return m_ranges.begin(); }
+    inline auto end() const { return m_ranges.end(); }
+    inline const Range& front() const { return m_ranges.front(); }
+    inline const Range& back() const { return m_ranges.back(); }
+};
+
+struct ShadowStats {
+    u64 bytesWritten {};
+    u64 bytesUploaded {};
+    u32 uploads {};
+    u32 flushes {};
+};
+
+// VBO with a host mirror: writes land in CPU memory and are recorded as
+// dirty ranges, flush() uploads them with as few GL calls as possible
+template<typename T, typename... Ts>
+class ShadowVBO {
+public:
+    using type = typename VBO<T, Ts...>::type;
+
+private:
+    VBO<T, Ts...> m_vbo;
+    std::vector<type> m_shadow;
+    DirtyRanges m_dirty;
+    ShadowStats m_stats;
+    u32 m_mergeGap;
+    u32 m_mapThreshold;
+
+    inline void markDirty(u32 begin, u32 size) {
+        m_dirty.add(begin, begin + size);
+        m_stats.bytesWritten += size;
+    }
+
+    inline u8* bytes() {
+        return reinterpret_cast<u8*>(m_shadow.data());
+    }
+
+public:
+    // merge_gap: clean bytes worth re-uploading to save a call
+    // map_threshold: number of ranges from which one mapped flush is used
+    inline ShadowVBO(u32 merge_gap = 256, u32 map_threshold = 8) : m_mergeGap(merge_gap), m_mapThreshold(map_threshold) {
+
+    }
+
+    // Reallocates the GPU buffer and uploads the whole mirror
+    inline auto& resize(u32 count, u32 draw_type = GL_DYNAMIC_DRAW) {
+        m_shadow.resize(count);
+        m_dirty.clear();
+        if (!dsa_enabled) m_vbo.use();
+        m_vbo.bufferData(m_shadow, draw_type);
+        m_stats.bytesUploaded += count * sizeof(type);
+        m_stats.uploads++;
+        return *this;
+    }
+
+    inline auto& write(u32 index, const type& value) {
+        m_shadow[index] = value;
+        markDirty(index * sizeof(type), sizeof(type));
+        return *this;
+    }
+
+    inline auto& write(std::span<const type> values, u32 offset) {
+        std::copy(values.begin(), values.end(), m_shadow.begin() + offset);
+        markDirty(offset * sizeof(type), values.size() * sizeof(type));
+        return *this;
+    }
+
+    // Writes one tuple field of one vertex, like VBO::bufferSubData. Whole
+    // vertices, whatever their value category, go to write(u32, const type&).
+    template<typename T2>
+    requires (IsTuple<type> && !IsSame<std::remove_cvref_t<T2>, type>)
+    inline auto& write(u32 index, T2&& value) {
+        using T2_noref = std::remove_cvref_t<T2>;
+        u32 offset = index * sizeof(type) + tupleOffset<T2_noref, type>();
+        std::memcpy(bytes() + offset, &value, sizeof(T2_noref));
+        markDirty(offset, sizeof(T2_noref));
+        return *this;
+    }
+
+    inline const type& operator[](u32 index) const {
+        return m_shadow[index];
+    }
+
+    inline auto& flush() {
+        if (m_dirty.empty()) return *this;
+
+        m_dirty.coalesce(m_mergeGap);
+        const bool dsa = dsa_enabled;
+        const u32 id = m_vbo.id();
+        if (!dsa) m_vbo.use();
+
+        if (m_dirty.size() >= m_mapThreshold) {
+            // One mapping over the dirty span, flushing only what changed
+            u32 base = m_dirty.front().begin;
+            u32 length = m_dirty.back().end - base;
+            const u32 access = GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+            u8* dst = static_cast<u8*>(dsa ? glMapNamedBufferRange(id, base, length, access) : glMapBufferRange(GL_ARRAY_BUFFER, base, length, access));
+            if (dst) {
+                for (auto& r : m_dirty) {
+                    std::memcpy(dst + (r.begin - base), bytes() + r.begin, r.end - r.begin);
+                    if (dsa) glFlushMappedNamedBufferRange(id, r.begin - base, r.end - r.begin);
+                    else glFlushMappedBufferRange(GL_ARRAY_BUFFER, r.begin - base, r.end - r.begin);
+                }
+                if (dsa) glUnmapNamedBuffer(id);
+                else glUnmapBuffer(GL_ARRAY_BUFFER);
+                m_stats.bytesUploaded += m_dirty.bytes();
+                m_stats.uploads++;
+                m_stats.flushes++;
+                m_dirty.clear();
+                return *this;
+            }
+            logDebug("glMapBufferRange failed, falling back to bufferSubData");
+        }
+
+        for (auto& r : m_dirty) {
+            if (dsa) glNamedBufferSubData(id, r.begin, r.end - r.begin, bytes() + r.begin);
+            else glBufferSubData(GL_ARRAY_BUFFER, r.begin, r.end - r.begin, bytes() + r.begin);
+            m_stats.uploads++;
+        }
+        m_stats.bytesUploaded += m_dirty.bytes();
+        m_stats.flushes++;
+        m_dirty.clear();
+        return *this;
+    }
+
+    inline u32 size() const {
+        return m_shadow.size();
+    }
+
+    inline const DirtyRanges& dirty() const {
+        return m_dirty;
+    }
+
+    inline const ShadowStats& stats() const {
+        return m_stats;
+    }
+
+    inline void resetStats() {
+        m_stats = {};
+    }
+
+    inline VBO<T, Ts...>& vbo() {
+        return m_vbo;
+    }
+};
+
+};
@@ -0,0 +1,299 @@
+#pragma once
+#include <span>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cppmaths/vec.hpp>
+#include <cppmaths/mat.hpp>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define GLABS_SKINNING_SSE 1
+#endif
+
+#include "backend.hpp"
+#include "registry.hpp"
+#include "memory.hpp"
+#include "threadpool.hpp"
+
+namespace GL {
+
+// Mat4 is 16 column-major floats, as the uniform uploads already assume
+static_assert(sizeof(Mat4) == 16 * sizeof(float));
+
+// out = a * b; out may alias either input
+inline void mulMat4(const Mat4& a, const Mat4& b, Mat4& out) {
+    auto* pa = reinterpret_cast<const float*>(&a);
+    auto* pb = reinterpret_cast<const float*>(&b);
+    auto* po = reinterpret_cast<float*>(&out);
+#ifdef GLABS_SKINNING_SSE
+    __m128 c0 = _mm_loadu_ps(pa);
+    __m128 c1 = _mm_loadu_ps(pa + 4);
+    __m128 c2 = _mm_loadu_ps(pa + 8);
+    __m128 c3 = _mm_loadu_ps(pa + 12);
+    for (u32 j {}; j < 4; j++) {
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(pb[4*j]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(pb[4*j + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(pb[4*j + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(pb[4*j + 3])));
+        _mm_storeu_ps(po + 4*j, r);
+    }
+#else
+    float r[16];
+    for (u32 j {}; j < 4; j++) {
+        for (u32 i {}; i < 4; i++) {
+            r[4*j + i] = pa[i] * pb[4*j] + pa[4 + i] * pb[4*j + 1] + pa[8 + i] * pb[4*j + 2] + pa[12 + i] * pb[4*j + 3];
+        }
+    }
+    for (u32 k {}; k < 16; k++) po[k] = r[k];
+#endif
+}
+
+// Stores the top three rows of an affine matrix: 48 bytes instead of 64. The
+// shader rebuilds a point as vec3(dot(r0, p), dot(r1, p), dot(r2, p)).
+inline void packMat4x3(const Mat4& m, Vec4* rows) {
+    auto* p = reinterpret_cast<const float*>(&m);
+    auto* out = reinterpret_cast<float*>(rows);
+#ifdef GLABS_SKINNING_SSE
+    __m128 c0 = _mm_loadu_ps(p);
+    __m128 c1 = _mm_loadu_ps(p + 4);
+    __m128 c2 = _mm_loadu_ps(p + 8);
+    __m128 c3 = _mm_loadu_ps(p + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(out, c0);
+    _mm_storeu_ps(out + 4, c1);
+    _mm_storeu_ps(out + 8, c2);
+#else
+    for (u32 r {}; r < 3; r++) {
+        for (u32 c {}; c < 4; c++) out[4*r + c] = p[4*c + r];
+    }
+#endif
+}
+
+// Bones are ordered so that parents[i] < i; roots have parent -1
+struct Skeleton {
+    std::vector<i32> parents;
+    std::vector<Mat4> inverseBind;
+
+    inline u32 bones() const {
+        return parents.size();
+    }
+
+    inline bool valid() const {
+        if (inverseBind.size() != parents.size()) return false;
+        for (u32 i {}; i < parents.size(); i++) {
+            if (parents[i] >= i32(i)) return false;
+        }
+        return true;
+    }
+};
+
+// paletteOffset of an instance compute() left out because its palette
+// doesn't fit the storage's limits
+constexpr u32 paletteRejected = ~0u;
+
+struct SkinInstance {
+    const Skeleton* skeleton;
+    const Mat4* local;          // skeleton->bones() bone-to-parent transforms
+    u32 paletteOffset {};       // Set by compute(): byte offset of the palette, or paletteRejected
+};
+
+enum class PaletteStorage : u8 {
+    Uniform,    // One UBO range per instance, bound with bindInstance
+    Texture     // A GL_RGBA32F texture buffer holding every palette
+};
+
+struct SkinningStats {
+    u32 instances {};
+    u32 rejected {};    // Instances over maxBones() or past the texture buffer size
+    u32 bones {};
+    u64 bytes {};       // Packed palette size of the last compute()
+    u64 computeNs {};
+    u64 uploadedBytes {};
+};
+
+// Turns local bone poses into skinning palettes (world * inverse bind),
+// spread over a thread pool, and streams them to the GPU packed as 4x3
+// matrices. Shaders read three vec4 rows per bone: from the instance's UBO
+// range, or with texelFetch(palette, base + bone * 3 + row) where
+// base = paletteOffset / 16.
+class SkinningSystem {
+    PaletteStorage m_storage;
+    ThreadPool* m_pool;
+    u32 m_buffer {};
+    u32 m_texture {};
+    u32 m_alignment {16};
+    u32 m_maxBones {};
+    u64 m_maxBytes {};  // Palette bytes one buffer binding can expose
+    u64 m_capacity {};
+    std::vector<Vec4> m_palette;
+    SkinningStats m_stats;
+
+    static constexpr u64 alignUp(u64 value, u64 alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    inline u32 target() const {
+        return m_storage == PaletteStorage::Uniform ? GL_UNIFORM_BUFFER : GL_TEXTURE_BUFFER;
+    }
+
+    inline void computeInstance(SkinInstance& instance, std::vector<Mat4>& world) {
+        const Skeleton& s = *instance.skeleton;
+        u32 n = s.bones();
+        world.resize(n);
+        Vec4* rows = m_palette.data() + instance.paletteOffset / sizeof(Vec4);
+        for (u32 b {}; b < n; b++) {
+            i32 parent = s.parents[b];
+            if (parent < 0) world[b] = instance.local[b];
+            else mulMat4(world[parent], instance.local[b], world[b]);
+            Mat4 skin;
+            mulMat4(world[b], s.inverseBind[b], skin);
+            packMat4x3(skin, rows + b * 3);
+        }
+    }
+
+public:
+    static constexpr u32 bytesPerBone = 3 * sizeof(Vec4);
+
+    inline SkinningSystem(PaletteStorage storage = PaletteStorage::Texture, ThreadPool* pool = nullptr)
+        : m_storage(storage), m_pool(pool) {
+        m_buffer = genName(ResourceKind::Buffer);
+        if (m_storage == PaletteStorage::Uniform) {
+            GLint alignment {}, blockSize {};
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &blockSize);
+            m_alignment = alignUp(std::max<u32>(alignment, 16), 16);
+            m_maxBones = blockSize / bytesPerBone;
+            m_maxBytes = ~0u;
+        } else {
+            // The limit is in texels, one Vec4 each
+            GLint texels {};
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &texels);
+            m_maxBytes = std::min<u64>(u64(texels) * sizeof(Vec4), ~0u);
+            m_texture = genTextureName(GL_TEXTURE_BUFFER);
+        }
+        logDebug("Created skinning system: %s palettes", m_storage == PaletteStorage::Uniform ? "uniform" : "texture");
+    }
+
+    SkinningSystem(const SkinningSystem&) = delete;
+    SkinningSystem& operator=(const SkinningSystem&) = delete;
+
+    // Lays the palettes out (sets paletteOffset) and fills them in parallel.
+    // Instances with more than maxBones() bones under uniform storage, or
+    // past GL_MAX_TEXTURE_BUFFER_SIZE under texture storage, are rejected:
+    // they get paletteRejected and must not be drawn skinned.
+    inline SkinningSystem& compute(std::span<SkinInstance> instances) {
+        auto start = std::chrono::steady_clock::now();
+        u64 offset {};
+        u32 bones {};
+        u32 rejected {};
+        for (auto& instance : instances) {
+            u32 n = instance.skeleton->bones();
+            u64 begin = alignUp(offset, m_alignment);
+            u64 end = begin + u64(n) * bytesPerBone;
+            if ((m_maxBones && n > m_maxBones) || end > m_maxBytes) {
+                if (!rejected++) {
+                    if (m_maxBones && n > m_maxBones) logDebug("Skinning: %d bones do not fit in one uniform block (max %d)", n, m_maxBones);
+                    else logDebug("Skinning: palettes exceed the texture buffer size (%llu bytes)", (unsigned long long) m_maxBytes);
+                }
+                instance.paletteOffset = paletteRejected;
+                continue;
+            }
+            instance.paletteOffset = begin;
+            offset = end;
+            bones += n;
+        }
+        m_palette.resize(alignUp(offset, m_alignment) / sizeof(Vec4));
+
+        auto run = [&](u32 begin, u32 end) {
+            thread_local std::vector<Mat4> world;
+            for (u32 i = begin; i < end; i++) {
+                if (instances[i].paletteOffset != paletteRejected) computeInstance(instances[i], world);
+            }
+        };
+        if (m_pool) m_pool->parallelFor(instances.size(), 16, run);
+        else run(0, instances.size());
+
+        m_stats.instances = instances.size();
+        m_stats.rejected = rejected;
+        m_stats.bones = bones;
+        m_stats.bytes = m_palette.size() * sizeof(Vec4);
+        m_stats.computeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return *this;
+    }
+
+    // Streams the palettes, orphaning last frame's storage so the driver
+    // doesn't wait for draws still reading it
+    inline SkinningSystem& upload() {
+        u64 bytes = m_palette.size() * sizeof(Vec4);
+        if (!bytes) return *this;
+        bool grow = bytes > m_capacity;
+        if (grow) m_capacity = std::max(bytes, m_capacity + m_capacity / 2);
+
+        if (dsa_enabled) {
+            glNamedBufferData(m_buffer, m_capacity, nullptr, GL_STREAM_DRAW);
+            glNamedBufferSubData(m_buffer, 0, bytes, m_palette.data());
+        } else {
+            glBindBuffer(target(), m_buffer);
+            glBufferData(target(), m_capacity, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(target(), 0, bytes, m_palette.data());
+        }
+        if (grow) {
+            trackMemory(ResourceKind::Buffer, m_buffer, m_storage == PaletteStorage::Uniform ? MemoryCategory::Uniform : MemoryCategory::Texture, m_capacity);
+            if (m_texture) {
+                if (dsa_enabled) {
+                    glTextureBuffer(m_texture, GL_RGBA32F, m_buffer);
+                } else {
+                    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+                    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+                }
+            }
+        }
+        m_stats.uploadedBytes += bytes;
+        return *this;
+    }
+
+    // Uniform storage: exposes one instance's palette to a uniform block.
+    // Rejected instances leave the binding alone.
+    inline SkinningSystem& bindInstance(u32 binding, const SkinInstance& instance) {
+        if (instance.paletteOffset == paletteRejected) {
+            logDebug("Skinning: not binding a rejected instance");
+            return *this;
+        }
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, instance.paletteOffset, instance.skeleton->bones() * bytesPerBone);
+        touchMemory(ResourceKind::Buffer, m_buffer);
+        return *this;
+    }
+
+    // Texture storage: binds the palette texture buffer to a texture unit
+    inline SkinningSystem& bindTexture(u32 unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+        touchMemory(ResourceKind::Buffer, m_buffer);
+        return *this;
+    }
+
+    inline std::span<const Vec4> palette() const {
+        return m_palette;
+    }
+
+    inline u32 buffer() const { return m_buffer; }
+    inline u32 texture() const { return m_texture; }
+    inline u32 maxBones() const { return m_maxBones; }
+
+    inline const SkinningStats& stats() const {
+        return m_stats;
+    }
+
+    inline ~SkinningSystem() {
+        untrackMemory(ResourceKind::Buffer, m_buffer);
+        deleteName(ResourceKind::Buffer, m_buffer);
+        if (m_texture) deleteName(ResourceKind::Texture, m_texture);
+        logDebug("Destroyed skinning system");
+    }
+};
+
+};
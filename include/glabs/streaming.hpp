@@ -0,0 +1,252 @@
+#pragma once
+#include <cmath>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/error.hpp>
+
+#include "texture.hpp"
+#include "memory.hpp"
+#include "threadpool.hpp"
+
+namespace GL {
+
+// Produces the pixels of one mip level. Runs on a pool thread when the
+// texture has one, so it must not touch GL.
+using MipSource = std::function<std::vector<u8>(u32 level)>;
+
+// 2D texture whose mip chain becomes resident coarse-to-fine. Only the levels
+// in [residentLevel(), levels) hold storage; GL_TEXTURE_BASE_LEVEL and
+// GL_TEXTURE_MIN_LOD are clamped to the finest resident level so sampling
+// never touches a missing one. When the memory tracker evicts a level, the
+// texture stays at most that coarse for a cooldown of update() calls and then
+// relaxes one level at a time, instead of streaming it straight back.
+class StreamingTexture {
+    struct Load {
+        std::mutex mutex;
+        bool done {};
+        std::vector<u8> pixels;
+    };
+
+    Texture<GL_TEXTURE_2D> m_texture;
+    i32 m_internalformat;
+    u32 m_format;
+    u32 m_type;
+    u32 m_width;
+    u32 m_height;
+    u32 m_levels;
+    MipSource m_source;
+    ThreadPool* m_pool;
+
+    u32 m_resident;     // Finest resident level, m_levels when none
+    u32 m_wanted;       // As requested; wantedLevel() applies m_floor
+    u32 m_floor {};     // Finest level allowed after an eviction
+    u32 m_cooldown {};  // Updates left before m_floor relaxes
+    u32 m_evictionCooldown {120};
+    float m_bias {};
+    std::shared_ptr<Load> m_pending;
+    u32 m_pendingLevel {};
+
+    inline u32 levelWidth(u32 level) const { return std::max(1u, m_width >> level); }
+    inline u32 levelHeight(u32 level) const { return std::max(1u, m_height >> level); }
+
+    inline void clamp() {
+        if (dsa_enabled) {
+            glTextureParameteri(m_texture.id(), GL_TEXTURE_BASE_LEVEL, m_resident);
+            glTextureParameterf(m_texture.id(), GL_TEXTURE_MIN_LOD, static_cast<float>(m_resident));
+            return;
+        }
+        m_texture.use();
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, m_resident);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, static_cast<float>(m_resident));
+    }
+
+    inline void upload(u32 level, const std::vector<u8>& pixels) {
+        m_texture.use();
+        glTexImage2D(GL_TEXTURE_2D, level, m_internalformat, levelWidth(level), levelHeight(level), 0, m_format, m_type, pixels.data());
+        trackMemory(ResourceKind::Texture, m_texture.id(), MemoryCategory::Texture, textureBytes(m_internalformat, levelWidth(level), levelHeight(level)), level);
+        m_resident = level;
+        clamp();
+    }
+
+    inline void startLoad(u32 level) {
+        auto load = std::make_shared<Load>();
+        m_pending = load;
+        m_pendingLevel = level;
+        if (!m_pool) {
+            load->pixels = m_source(level);
+            load->done = true;
+            return;
+        }
+        m_pool->submit([load, source = m_source, level] {
+            auto pixels = source(level);
+            std::lock_guard lock(load->mutex);
+            load->pixels = std::move(pixels);
+            load->done = true;
+        });
+    }
+
+public:
+    inline StreamingTexture(
+        u32 width,
+        u32 height,
+        u32 levels,
+        i32 internalformat,
+        u32 format,
+        u32 type,
+        MipSource source,
+        ThreadPool* pool = nullptr,
+        u32 filter = GL_LINEAR_MIPMAP_LINEAR
+    ) : m_texture(GL_LINEAR, GL_CLAMP_TO_EDGE), m_internalformat(internalformat), m_format(format), m_type(type),
+        m_width(width), m_height(height), m_levels(levels), m_source(std::move(source)), m_pool(pool),
+        m_resident(levels), m_wanted(levels - 1) {
+        if (levels == 0) abort("StreamingTexture needs at least one mip level");
+        m_texture.use();
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        bool nearest = filter == GL_NEAREST || filter == GL_NEAREST_MIPMAP_NEAREST || filter == GL_NEAREST_MIPMAP_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+        // The coarsest level is tiny; load it now so the texture is always complete
+        upload(levels - 1, m_source(levels - 1));
+
+        if (memory_tracker) {
+            memory_tracker->setEvictor(resourceKey(ResourceKind::Texture, m_texture.id()), [this] {
+                if (m_resident + 1 >= m_levels) return;
+                m_floor = m_resident + 1;
+                m_cooldown = m_evictionCooldown;
+                // Eviction may run while the caller has another texture bound;
+                // trim() only binds on the active unit, so that is all to restore
+                GLint bound {};
+                glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+                trim(m_floor);
+                glBindTexture(GL_TEXTURE_2D, bound);
+            });
+        }
+    }
+
+    StreamingTexture(const StreamingTexture&) = delete;
+    StreamingTexture& operator=(const StreamingTexture&) = delete;
+
+    // Screen-space size estimate: the level whose texels are about one pixel
+    static inline float lodForScreenSize(u32 textureSize, float screenPixels) {
+        if (screenPixels <= 0.f) return 1e9f;
+        return std::log2(static_cast<float>(textureSize) / screenPixels);
+    }
+
+    inline StreamingTexture& setBias(float bias) {
+        m_bias = bias;
+        return *this;
+    }
+
+    // Updates an evicted texture waits before each level it may stream back
+    inline StreamingTexture& setEvictionCooldown(u32 updates) {
+        m_evictionCooldown = updates;
+        return *this;
+    }
+
+    // Finest level wanted, e.g. from lodForScreenSize or sampler feedback
+    inline StreamingTexture& request(float lod) {
+        float l = std::floor(lod + m_bias);
+        m_wanted = l <= 0.f ? 0 : std::min<u32>(static_cast<u32>(l), m_levels - 1);
+        return *this;
+    }
+
+    // Render thread: finishes a completed load and starts the next one.
+    // Returns the bytes uploaded, at most one level per call.
+    inline u64 update() {
+        u64 uploaded {};
+        if (m_floor && (m_cooldown == 0 || --m_cooldown == 0)) {
+            m_floor--;
+            m_cooldown = m_floor ? m_evictionCooldown : 0;
+        }
+        u32 wanted = wantedLevel();
+        if (m_pending) {
+            std::unique_lock lock(m_pending->mutex);
+            if (!m_pending->done) return 0;
+            auto pixels = std::move(m_pending->pixels);
+            lock.unlock();
+            m_pending.reset();
+            // The request may have moved coarser while this was loading
+            if (m_pendingLevel + 1 == m_resident && m_pendingLevel >= wanted) {
+                upload(m_pendingLevel, pixels);
+                uploaded = pixels.size();
+            }
+        }
+
+        if (!m_pending && m_resident > wanted && m_resident > 0) {
+            startLoad(m_resident - 1);
+        }
+        if (m_resident < wanted) {
+            trim(wanted);
+        }
+        return uploaded;
+    }
+
+    // Drops every level finer than `level`, e.g. under memory pressure
+    inline StreamingTexture& trim(u32 level) {
+        level = std::min(level, m_levels - 1);
+        if (level <= m_resident) return *this;
+        u32 old = m_resident;
+        m_resident = level;
+        clamp();
+        // clamp() skips the bind under DSA, and the level loop is bind-based
+        m_texture.use();
+        for (u32 l = old; l < level; l++) {
+            glTexImage2D(GL_TEXTURE_2D, l, m_internalformat, 0, 0, 0, m_format, m_type, nullptr);
+            trackMemory(ResourceKind::Texture, m_texture.id(), MemoryCategory::Texture, 0, l);
+        }
+        return *this;
+    }
+
+    inline u32 residentLevel() const { return m_resident; }
+    inline u32 wantedLevel() const { return std::max(m_wanted, m_floor); }
+    inline u32 levels() const { return m_levels; }
+    inline bool streaming() const { return m_pending != nullptr; }
+
+    inline auto& use() {
+        return m_texture.use();
+    }
+
+    inline Texture<GL_TEXTURE_2D>& texture() {
+        return m_texture;
+    }
+
+    inline ~StreamingTexture() {
+        if (memory_tracker) memory_tracker->setEvictor(resourceKey(ResourceKind::Texture, m_texture.id()), {});
+    }
+};
+
+// Advances many streaming textures under a per-frame upload budget, giving
+// priority to the textures furthest from the level they want
+class TextureStreamer {
+    std::vector<StreamingTexture*> m_textures;
+
+public:
+    inline void add(StreamingTexture& texture) {
+        m_textures.push_back(&texture);
+    }
+
+    inline void remove(StreamingTexture& texture) {
+        std::erase(m_textures, &texture);
+    }
+
+    // Returns the bytes uploaded this call
+    inline u64 update(u64 budgetBytes) {
+        std::sort(m_textures.begin(), m_textures.end(), [](StreamingTexture* a, StreamingTexture* b) {
+            return i32(a->residentLevel()) - i32(a->wantedLevel()) > i32(b->residentLevel()) - i32(b->wantedLevel());
+        });
+        u64 uploaded {};
+        for (auto* t : m_textures) {
+            if (uploaded >= budgetBytes) break;
+            uploaded += t->update();
+        }
+        return uploaded;
+    }
+};
+
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <utility>
 #include <glad/glad.h>
 #include <cpputils/types.hpp>
 #include <cpputils/debug.hpp>
@@ -7,6 +8,8 @@
 #include <glm/ext/vector_int3.hpp>
 
 #include "imagedata.hpp"
+#include "registry.hpp"
+#include "memory.hpp"
 
 namespace GL {
 
@@ -17,12 +20,25 @@ class Texture {
 public:
     Texture(u32 option_filter = GL_NEAREST, u32 option_wrap = GL_CLAMP_TO_BORDER);
 
+    // Owns its name: moves hand it over, copies would delete it twice
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    inline Texture(Texture&& other) : m_id(std::exchange(other.m_id, 0)) {
+
+    }
+
+    inline Texture& operator=(Texture&& other) {
+        std::swap(m_id, other.m_id);
+        return *this;
+    }
+
     auto& setImage(
         i32 internalformat, 
         i32 format, 
         i32 width, 
         void* data, 
-        u32 type = target, 
+        u32 type = GL_UNSIGNED_BYTE, 
         u32 detail = 0, 
         u32 border = 0
     ) requires (target == GL_TEXTURE_1D);
@@ -31,7 +47,7 @@ public:
         i32 format, 
         glm::ivec2 size, 
         void* data, 
-        u32 type = target, 
+        u32 type = GL_UNSIGNED_BYTE, 
         u32 detail = 0, 
         u32 border = 0
     ) requires (target == GL_TEXTURE_2D);
@@ -40,7 +56,7 @@ public:
         i32 format, 
         glm::ivec3 size, 
         void* data, 
-        u32 type = target, 
+        u32 type = GL_UNSIGNED_BYTE, 
         u32 detail = 0, 
         u32 border = 0
     ) requires (target == GL_TEXTURE_3D);
@@ -50,7 +66,7 @@ public:
         i32 offsetX, 
         i32 width, 
         void* data, 
-        u32 type = target, 
+        u32 type = GL_UNSIGNED_BYTE, 
         u32 detail = 0, 
         u32 border = 0
     ) requires (target == GL_TEXTURE_1D);
@@ -59,7 +75,7 @@ public:
         glm::ivec2 offset, 
         glm::ivec2 size, 
         void* data, 
-        u32 type = target, 
+        u32 type = GL_UNSIGNED_BYTE, 
         u32 detail = 0, 
         u32 border = 0
     ) requires (target == GL_TEXTURE_2D);
@@ -68,25 +84,34 @@ public:
         glm::ivec3 offset, 
         glm::ivec3 size, 
         void* data, 
-        u32 type = target, 
+        u32 type = GL_UNSIGNED_BYTE, 
         u32 detail = 0, 
         u32 border = 0
     ) requires (target == GL_TEXTURE_3D);
 
     auto& use();
     auto& unuse();
+    u32 id() const;
     ~Texture();
 };
 
 template<u32 target>
 inline Texture<target>::Texture(u32 option_filter, u32 option_wrap) {
-    glGenTextures(1, &m_id);
-    use();
+    m_id = genTextureName(target);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexParameteri(type, GL_TEXTURE_WRAP_S, option_wrap);
-    glTexParameteri(type, GL_TEXTURE_WRAP_T, option_wrap);
-    glTexParameteri(type, GL_TEXTURE_MAG_FILTER, option_filter);
-    glTexParameteri(type, GL_TEXTURE_MIN_FILTER, option_filter);
+    if (dsa_enabled) {
+        glTextureParameteri(m_id, GL_TEXTURE_WRAP_S, option_wrap);
+        glTextureParameteri(m_id, GL_TEXTURE_WRAP_T, option_wrap);
+        glTextureParameteri(m_id, GL_TEXTURE_MAG_FILTER, option_filter);
+        glTextureParameteri(m_id, GL_TEXTURE_MIN_FILTER, option_filter);
+        logDebug("Created texture %d", m_id);
+        return;
+    }
+    use();
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, option_wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, option_wrap);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, option_filter);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, option_filter);
     logDebug("Created texture %d", m_id);
     unuse();
 }
@@ -102,7 +127,7 @@ inline auto& Texture<target>::setImage(
     u32 border
 ) requires (target == GL_TEXTURE_1D) {
     glTexImage1D(
-        type, 
+        target, 
         detail, 
         internalformat,
         width, 
@@ -111,6 +136,7 @@ inline auto& Texture<target>::setImage(
         type, 
         data
     );
+    trackMemory(ResourceKind::Texture, m_id, MemoryCategory::Texture, textureBytes(internalformat, width), detail);
     return *this;
 }
 
@@ -125,7 +151,7 @@ inline auto& Texture<target>::setImage(
     u32 border
 ) requires (target == GL_TEXTURE_2D) {
     glTexImage2D(
-        type, 
+        target, 
         detail, 
         internalformat, 
         size.x, 
@@ -135,6 +161,7 @@ inline auto& Texture<target>::setImage(
         type, 
         data
     ); 
+    trackMemory(ResourceKind::Texture, m_id, MemoryCategory::Texture, textureBytes(internalformat, size.x, size.y), detail);
     return *this;
 }
 
@@ -149,7 +176,7 @@ inline auto& Texture<target>::setImage(
     u32 border
 ) requires (target == GL_TEXTURE_3D) {
     glTexImage3D(
-        type, 
+        target, 
         detail, 
         internalformat, 
         size.x, 
@@ -160,6 +187,7 @@ inline auto& Texture<target>::setImage(
         type,
         data
     );
+    trackMemory(ResourceKind::Texture, m_id, MemoryCategory::Texture, textureBytes(internalformat, size.x, size.y, size.z), detail);
     return *this;
 }
 
@@ -173,8 +201,12 @@ inline auto& Texture<target>::subImage(
     u32 detail, 
     u32 border
 ) requires (target == GL_TEXTURE_1D) {
+    if (dsa_enabled) {
+        glTextureSubImage1D(m_id, detail, offsetX, width, format, type, data);
+        return *this;
+    }
     glTexSubImage1D(
-        type, 
+        target, 
         detail, 
         offsetX, 
         width, 
@@ -195,8 +227,12 @@ inline auto& Texture<target>::subImage(
     u32 detail, 
     u32 border
 ) requires (target == GL_TEXTURE_2D) {
+    if (dsa_enabled) {
+        glTextureSubImage2D(m_id, detail, offset.x, offset.y, size.x, size.y, format, type, data);
+        return *this;
+    }
     glTexSubImage2D(
-        type, 
+        target, 
         detail, 
         offset.x, 
         offset.y, 
@@ -219,8 +255,12 @@ inline auto& Texture<target>::subImage(
     u32 detail, 
     u32 border
 ) requires (target == GL_TEXTURE_3D) {
+    if (dsa_enabled) {
+        glTextureSubImage3D(m_id, detail, offset.x, offset.y, offset.z, size.x, size.y, size.z, format, type, data);
+        return *this;
+    }
     glTexSubImage3D(
-        type, 
+        target, 
         detail, 
         offset.x, 
         offset.y, 
@@ -238,19 +278,27 @@ inline auto& Texture<target>::subImage(
 template<u32 target>
 inline auto& Texture<target>::use() {
     //glActiveTexture(GL_TEXTURE0);
-    glBindTexture(type, m_id);
+    glBindTexture(target, m_id);
+    touchMemory(ResourceKind::Texture, m_id);
     return *this;
 }
 
 template<u32 target>
 inline auto& Texture<target>::unuse() {
-    glBindTexture(image, 0);
+    glBindTexture(target, 0);
     return *this;
 }
 
+template<u32 target>
+inline u32 Texture<target>::id() const {
+    return m_id;
+}
+
 template<u32 target>
 inline Texture<target>::~Texture() {
-    glDeleteTextures(1, &m_id);
+    if (!m_id) return;
+    untrackMemory(ResourceKind::Texture, m_id);
+    deleteName(ResourceKind::Texture, m_id);
     logDebug("Destroyed texture %d", m_id);
 }
 
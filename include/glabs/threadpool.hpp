@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <cpputils/types.hpp>
+
+namespace GL {
+
+// Fixed set of threads pulling jobs from one queue. onStart/onStop run on
+// each worker with its index, e.g. to bind and unbind a per-thread context.
+class ThreadPool {
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop {};
+
+public:
+    inline ThreadPool(
+        u32 threads = std::thread::hardware_concurrency(),
+        std::function<void(u32)> onStart = {},
+        std::function<void(u32)> onStop = {}
+    ) {
+        if (threads == 0) threads = 1;
+        for (u32 i {}; i < threads; i++) {
+            m_threads.emplace_back([this, i, onStart, onStop] {
+                if (onStart) onStart(i);
+                for (;;) {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock lock(m_mutex);
+                        m_cv.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+                        if (m_jobs.empty()) break;
+                        job = std::move(m_jobs.front());
+                        m_jobs.pop_front();
+                    }
+                    job();
+                }
+                if (onStop) onStop(i);
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Drains the queue before joining
+    inline ~ThreadPool() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto& t : m_threads) t.join();
+    }
+
+    template<typename F>
+    inline void submit(F&& job) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_jobs.emplace_back(std::forward<F>(job));
+        }
+        m_cv.notify_one();
+    }
+
+    // Runs fn(begin, end) over [0, count) in chunks of at most grain and
+    // returns once every chunk is done. The calling thread works too, so this
+    // is safe to call from inside a pool job.
+    template<typename F>
+    inline void parallelFor(u32 count, u32 grain, F&& fn) {
+        if (count == 0) return;
+        if (grain == 0) grain = 1;
+        u32 chunks = (count + grain - 1) / grain;
+        if (chunks == 1) {
+            fn(0u, count);
+            return;
+        }
+
+        struct State {
+            std::atomic<u32> next {};
+            std::atomic<u32> done {};
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+        auto state = std::make_shared<State>();
+        auto run = [state, count, grain, chunks, &fn] {
+            for (u32 c; (c = state->next.fetch_add(1)) < chunks;) {
+                fn(c * grain, std::min(count, (c + 1) * grain));
+                if (state->done.fetch_add(1) + 1 == chunks) {
+                    std::lock_guard lock(state->mutex);
+                    state->cv.notify_all();
+                }
+            }
+        };
+
+        u32 helpers = std::min<u32>(chunks - 1, m_threads.size());
+        for (u32 i {}; i < helpers; i++) submit(run);
+        run();
+
+        std::unique_lock lock(state->mutex);
+        state->cv.wait(lock, [&] { return state->done.load() == chunks; });
+    }
+
+    inline u32 size() const {
+        return m_threads.size();
+    }
+};
+
+};
@@ -0,0 +1,1127 @@
+#pragma once
+#include <bit>
+#include <span>
+#include <cstdint>
+#include <type_traits>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+
+#include "backend.hpp"
+#include "hash.hpp"
+#include "mesh.hpp"
+
+namespace GL {
+
+// GL command capture (.glbt). While a GLCapture is running, the glad function
+// pointers of the calls below are swapped for thunks that append a record and
+// forward to the driver. Payloads (buffer data, pixels, shader sources,
+// uniform arrays) are written once as blobs keyed by hash64 and referenced by
+// hash afterwards, so a static mesh re-uploaded every frame costs 8 bytes.
+//
+//   TraceHeader | records...
+//   record: u16 op | u8 argc | u8 flags | u64 args[argc]
+//   blob:   Blob record (hash, size) followed by size bytes
+//
+// GLReplay re-executes a trace, remapping object names, sync objects and
+// uniform locations to the ones the replay context hands out.
+
+// Op codes are stored in traces: append new calls at the end of the list
+// and bump traceVersion whenever an existing entry moves or changes its
+// arguments.
+#define GLABS_TRACE_CALLS(X) \
+    X(GenBuffers, Object) X(CreateBuffers, Object) X(DeleteBuffers, Object) \
+    X(GenTextures, Object) X(CreateTextures, Object) X(DeleteTextures, Object) \
+    X(GenVertexArrays, Object) X(CreateVertexArrays, Object) X(DeleteVertexArrays, Object) \
+    X(GenFramebuffers, Object) X(CreateFramebuffers, Object) X(DeleteFramebuffers, Object) \
+    X(CreateProgram, Object) X(DeleteProgram, Object) X(CreateShader, Object) X(DeleteShader, Object) \
+    X(ShaderSource, Shader) X(CompileShader, Shader) X(AttachShader, Shader) X(LinkProgram, Shader) \
+    X(GetUniformLocation, Shader) \
+    X(UseProgram, Bind) X(BindBuffer, Bind) X(BindBufferRange, Bind) X(BindVertexArray, Bind) \
+    X(ActiveTexture, Bind) X(BindTexture, Bind) X(BindFramebuffer, Bind) \
+    X(Uniform1i, Uniform) X(Uniform1f, Uniform) X(Uniform2fv, Uniform) X(Uniform3fv, Uniform) \
+    X(Uniform4fv, Uniform) X(Uniform2uiv, Uniform) X(UniformMatrix3fv, Uniform) X(UniformMatrix4fv, Uniform) \
+    X(BufferData, Upload) X(BufferSubData, Upload) X(BufferStorage, Upload) \
+    X(NamedBufferData, Upload) X(NamedBufferSubData, Upload) X(NamedBufferStorage, Upload) \
+    X(MapBufferRange, Upload) X(MapNamedBufferRange, Upload) \
+    X(FlushMappedBufferRange, Upload) X(FlushMappedNamedBufferRange, Upload) \
+    X(UnmapBuffer, Upload) X(UnmapNamedBuffer, Upload) \
+    X(PixelStorei, Upload) X(TexImage1D, Upload) X(TexImage2D, Upload) X(TexImage3D, Upload) \
+    X(TexSubImage1D, Upload) X(TexSubImage2D, Upload) X(TexSubImage3D, Upload) \
+    X(TextureSubImage1D, Upload) X(TextureSubImage2D, Upload) X(TextureSubImage3D, Upload) \
+    X(VertexAttribPointer, Layout) X(EnableVertexAttribArray, Layout) X(VertexAttribDivisor, Layout) \
+    X(VertexArrayVertexBuffer, Layout) X(VertexArrayAttribFormat, Layout) X(VertexArrayAttribBinding, Layout) \
+    X(EnableVertexArrayAttrib, Layout) X(VertexArrayBindingDivisor, Layout) X(VertexArrayElementBuffer, Layout) \
+    X(FramebufferTexture2D, Layout) X(NamedFramebufferTexture, Layout) \
+    X(Enable, State) X(Disable, State) X(BlendFunc, State) X(DepthFunc, State) \
+    X(Viewport, State) X(ClearColor, State) \
+    X(TexParameteri, State) X(TexParameterf, State) X(TextureParameteri, State) X(TextureParameterf, State) \
+    X(Clear, Draw) X(DrawArrays, Draw) X(DrawArraysInstanced, Draw) \
+    X(DrawElements, Draw) X(DrawElementsInstanced, Draw) \
+    X(FenceSync, Sync) X(ClientWaitSync, Sync) X(DeleteSync, Sync) \
+    X(Uniform1iv, Uniform) X(Uniform1fv, Uniform) \
+    X(TexBuffer, Upload) X(TextureBuffer, Upload) X(VertexAttribIPointer, Layout) \
+    X(GenTransformFeedbacks, Object) X(CreateTransformFeedbacks, Object) X(DeleteTransformFeedbacks, Object) \
+    X(TransformFeedbackVaryings, Shader) \
+    X(BindBufferBase, Bind) X(BindTransformFeedback, Bind) X(TransformFeedbackBufferBase, Bind) \
+    X(BeginTransformFeedback, Draw) X(EndTransformFeedback, Draw) \
+    X(GenQueries, Object) X(CreateQueries, Object) X(DeleteQueries, Object) \
+    X(ColorMask, State) X(DepthMask, State) \
+    X(BeginQuery, Draw) X(EndQuery, Draw) X(BeginConditionalRender, Draw) X(EndConditionalRender, Draw) \
+    X(GetQueryObjectuiv, Sync)
+
+enum class TraceOp : u16 {
+    Frame,
+    Blob,
+#define X(name, category) name,
+    GLABS_TRACE_CALLS(X)
+#undef X
+    Count
+};
+
+constexpr u32 traceOpCount = static_cast<u32>(TraceOp::Count);
+
+enum class TraceCategory : u8 {
+    Marker,
+    Object,
+    Shader,
+    Bind,
+    Uniform,
+    Upload,
+    Layout,
+    State,
+    Draw,
+    Sync
+};
+
+constexpr TraceCategory traceCategory[] {
+    TraceCategory::Marker,
+    TraceCategory::Marker,
+#define X(name, category) TraceCategory::category,
+    GLABS_TRACE_CALLS(X)
+#undef X
+};
+
+constexpr const char* traceOpName[] {
+    "Frame",
+    "Blob",
+#define X(name, category) "gl" #name,
+    GLABS_TRACE_CALLS(X)
+#undef X
+};
+
+struct TraceHeader {
+    char magic[4];
+    u32 version;
+};
+
+constexpr u32 traceVersion = 1;
+
+// Pointer arguments recorded as buffer offsets rather than blob hashes
+constexpr u8 traceFlagOffset = 1;
+
+// Client memory read by a pixel transfer, honouring GL_UNPACK_ALIGNMENT
+constexpr u64 pixelBytes(u32 format, u32 type, i32 width, i32 height, i32 depth, u32 alignment) {
+    u32 size;
+    switch (type) {
+    case GL_UNSIGNED_BYTE: case GL_BYTE:
+        size = 1; break;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+        size = 2; break;
+    case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+        size = 2; format = 0; break;
+    case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_10F_11F_11F_REV: case GL_UNSIGNED_INT_5_9_9_9_REV:
+        size = 4; format = 0; break;
+    default:
+        size = 4; break;
+    }
+    u32 components;
+    switch (format) {
+    case 0: // Packed type, one value per pixel
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+        components = 1; break;
+    case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL:
+        components = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+        components = 3; break;
+    default:
+        components = 4; break;
+    }
+    if (width <= 0 || height <= 0 || depth <= 0) return 0;
+    u64 row = u64(width) * size * components;
+    u64 stride = (row + alignment - 1) / alignment * alignment;
+    return stride * (u64(height) * depth - 1) + row;
+}
+
+struct CaptureStats {
+    u64 calls {};
+    u64 frames {};
+    u64 blobs {};
+    u64 blobBytes {};
+    u64 dedupedBytes {};    // payload bytes not written because already in the file
+    u64 ignoredCalls {};    // calls made off the capturing thread, not recorded
+};
+
+struct TraceThunks;
+
+// Records the GL stream of the context current on the thread that calls
+// start(); the trace has no context ids, so GLReplay runs it on one context.
+// Calls other threads make through glad's shared pointers, e.g. from
+// ContextWorkers, reach the driver but are left out of the file and counted
+// in CaptureStats::ignoredCalls: a trace with ignored calls may not replay
+// faithfully. Start it before any object is created so the replay sees every
+// name being born. Persistent mappings can't be observed, so buffer storage
+// is turned off while capturing.
+class GLCapture {
+    friend struct TraceThunks;
+
+    struct Mapping {
+        u8* data;
+        u64 length;
+        u32 access;
+    };
+
+    FILE* m_file {};
+    std::thread::id m_thread;
+    std::mutex m_mutex;
+    std::unordered_set<u64> m_blobs;
+    CaptureStats m_stats;
+    bool m_bufferStorage {};
+
+    // Client state the payload sizes depend on, guarded by m_mutex
+    u32 m_unpackAlignment {4};
+    u32 m_unpackBuffer {};
+    std::unordered_map<u64, Mapping> m_maps;
+
+    template<typename T>
+    static inline u64 arg(T value) {
+        if constexpr (std::is_floating_point_v<T>) return std::bit_cast<u32>(static_cast<float>(value));
+        else if constexpr (std::is_pointer_v<T>) return reinterpret_cast<std::uintptr_t>(value);
+        else return static_cast<u64>(static_cast<i64>(value));
+    }
+
+    // Caller holds m_mutex
+    inline void write(TraceOp op, const u64* args, u8 argc, u8 flags) {
+        u8 head[4];
+        u16 code = static_cast<u16>(op);
+        std::memcpy(head, &code, 2);
+        head[2] = argc;
+        head[3] = flags;
+        std::fwrite(head, 1, 4, m_file);
+        std::fwrite(args, sizeof(u64), argc, m_file);
+    }
+
+    // Set once by start(), before the thunks are installed
+    inline bool captured() const {
+        return std::this_thread::get_id() == m_thread;
+    }
+
+    inline void record(TraceOp op, std::initializer_list<u64> args, u8 flags = 0) {
+        std::lock_guard lock(m_mutex);
+        if (!m_file) return;
+        if (!captured()) {
+            if (!m_stats.ignoredCalls++) logDebug("Trace: ignoring %s and later calls from other threads", traceOpName[static_cast<u16>(op)]);
+            return;
+        }
+        write(op, args.begin(), args.size(), flags);
+        m_stats.calls++;
+    }
+
+    // Writes the payload unless an identical one is already in the file.
+    // Returns its hash, 0 for none.
+    inline u64 blob(const void* data, u64 size) {
+        if (!data || !size || !captured()) return 0;
+        u64 hash = hash64(data, size) | 1;
+        std::lock_guard lock(m_mutex);
+        if (!m_file) return hash;
+        if (!m_blobs.insert(hash).second) {
+            m_stats.dedupedBytes += size;
+            return hash;
+        }
+        u64 args[2] {hash, size};
+        write(TraceOp::Blob, args, 2, 0);
+        std::fwrite(data, 1, size, m_file);
+        m_stats.blobs++;
+        m_stats.blobBytes += size;
+        return hash;
+    }
+
+    inline u64 names(const u32* names, i32 n) {
+        return blob(names, u64(std::max(n, 0)) * sizeof(u32));
+    }
+
+    // Pixels come from the bound unpack buffer when there is one
+    inline u64 pixels(const void* data, u32 format, u32 type, i32 w, i32 h, i32 d, u8& flags) {
+        if (!captured()) return 0;
+        u32 alignment;
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_unpackBuffer) {
+                flags = traceFlagOffset;
+                return arg(data);
+            }
+            alignment = m_unpackAlignment;
+        }
+        return blob(data, pixelBytes(format, type, w, h, d, alignment));
+    }
+
+    inline void unpackBuffer(u32 buffer) {
+        std::lock_guard lock(m_mutex);
+        if (captured()) m_unpackBuffer = buffer;
+    }
+
+    inline void unpackAlignment(u32 alignment) {
+        std::lock_guard lock(m_mutex);
+        if (captured()) m_unpackAlignment = alignment;
+    }
+
+    // Mapped writes are captured when they become visible: at explicit
+    // flushes, or for the whole range at unmap
+    inline void mapped(u64 key, void* data, u64 length, u32 access) {
+        if (access & GL_MAP_PERSISTENT_BIT) logDebug("Trace: writes through persistent mappings are not captured");
+        std::lock_guard lock(m_mutex);
+        if (data && captured()) m_maps[key] = {static_cast<u8*>(data), length, access};
+    }
+
+    inline u64 flushed(u64 key, u64 offset, u64 length) {
+        u8* data;
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = m_maps.find(key);
+            if (it == m_maps.end()) return 0;
+            data = it->second.data;
+        }
+        return blob(data + offset, length);
+    }
+
+    inline u64 unmapped(u64 key) {
+        Mapping m;
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = m_maps.find(key);
+            if (it == m_maps.end()) return 0;
+            m = it->second;
+            m_maps.erase(it);
+        }
+        bool whole = (m.access & GL_MAP_WRITE_BIT) && !(m.access & GL_MAP_FLUSH_EXPLICIT_BIT);
+        return whole ? blob(m.data, m.length) : 0;
+    }
+
+    void install();
+    void restore();
+
+public:
+    GLCapture() = default;
+    GLCapture(const GLCapture&) = delete;
+    GLCapture& operator=(const GLCapture&) = delete;
+
+    inline bool start(const char* path);
+    inline void stop();
+
+    // Marks the end of a frame, e.g. right before swapping buffers
+    inline void frame() {
+        record(TraceOp::Frame, {});
+        std::lock_guard lock(m_mutex);
+        m_stats.frames++;
+    }
+
+    inline bool capturing() const {
+        return m_file != nullptr;
+    }
+
+    inline CaptureStats stats() {
+        std::lock_guard lock(m_mutex);
+        return m_stats;
+    }
+
+    inline ~GLCapture() {
+        stop();
+    }
+};
+
+// Set while a capture is running
+inline GLCapture* gl_capture {};
+
+// Drivers' entry points, saved while the thunks are installed
+struct TraceOriginals {
+#define X(name, category) static inline decltype(glad_gl##name) name {};
+    GLABS_TRACE_CALLS(X)
+#undef X
+};
+
+struct TraceThunks {
+    using O = TraceOriginals;
+
+    static inline GLCapture& c() {
+        return *gl_capture;
+    }
+
+    template<typename T>
+    static inline u64 a(T value) {
+        return GLCapture::arg(value);
+    }
+
+    // Objects: output names are recorded after the call
+    static void APIENTRY GenBuffers(GLsizei n, GLuint* names) { O::GenBuffers(n, names); c().record(TraceOp::GenBuffers, {a(n), c().names(names, n)}); }
+    static void APIENTRY CreateBuffers(GLsizei n, GLuint* names) { O::CreateBuffers(n, names); c().record(TraceOp::CreateBuffers, {a(n), c().names(names, n)}); }
+    static void APIENTRY DeleteBuffers(GLsizei n, const GLuint* names) { c().record(TraceOp::DeleteBuffers, {a(n), c().names(names, n)}); O::DeleteBuffers(n, names); }
+    static void APIENTRY GenTextures(GLsizei n, GLuint* names) { O::GenTextures(n, names); c().record(TraceOp::GenTextures, {a(n), c().names(names, n)}); }
+    static void APIENTRY CreateTextures(GLenum target, GLsizei n, GLuint* names) { O::CreateTextures(target, n, names); c().record(TraceOp::CreateTextures, {a(target), a(n), c().names(names, n)}); }
+    static void APIENTRY DeleteTextures(GLsizei n, const GLuint* names) { c().record(TraceOp::DeleteTextures, {a(n), c().names(names, n)}); O::DeleteTextures(n, names); }
+    static void APIENTRY GenVertexArrays(GLsizei n, GLuint* names) { O::GenVertexArrays(n, names); c().record(TraceOp::GenVertexArrays, {a(n), c().names(names, n)}); }
+    static void APIENTRY CreateVertexArrays(GLsizei n, GLuint* names) { O::CreateVertexArrays(n, names); c().record(TraceOp::CreateVertexArrays, {a(n), c().names(names, n)}); }
+    static void APIENTRY DeleteVertexArrays(GLsizei n, const GLuint* names) { c().record(TraceOp::DeleteVertexArrays, {a(n), c().names(names, n)}); O::DeleteVertexArrays(n, names); }
+    static void APIENTRY GenFramebuffers(GLsizei n, GLuint* names) { O::GenFramebuffers(n, names); c().record(TraceOp::GenFramebuffers, {a(n), c().names(names, n)}); }
+    static void APIENTRY CreateFramebuffers(GLsizei n, GLuint* names) { O::CreateFramebuffers(n, names); c().record(TraceOp::CreateFramebuffers, {a(n), c().names(names, n)}); }
+    static void APIENTRY DeleteFramebuffers(GLsizei n, const GLuint* names) { c().record(TraceOp::DeleteFramebuffers, {a(n), c().names(names, n)}); O::DeleteFramebuffers(n, names); }
+    static void APIENTRY GenTransformFeedbacks(GLsizei n, GLuint* names) { O::GenTransformFeedbacks(n, names); c().record(TraceOp::GenTransformFeedbacks, {a(n), c().names(names, n)}); }
+    static void APIENTRY CreateTransformFeedbacks(GLsizei n, GLuint* names) { O::CreateTransformFeedbacks(n, names); c().record(TraceOp::CreateTransformFeedbacks, {a(n), c().names(names, n)}); }
+    static void APIENTRY DeleteTransformFeedbacks(GLsizei n, const GLuint* names) { c().record(TraceOp::DeleteTransformFeedbacks, {a(n), c().names(names, n)}); O::DeleteTransformFeedbacks(n, names); }
+    static void APIENTRY GenQueries(GLsizei n, GLuint* names) { O::GenQueries(n, names); c().record(TraceOp::GenQueries, {a(n), c().names(names, n)}); }
+    static void APIENTRY CreateQueries(GLenum target, GLsizei n, GLuint* names) { O::CreateQueries(target, n, names); c().record(TraceOp::CreateQueries, {a(target), a(n), c().names(names, n)}); }
+    static void APIENTRY DeleteQueries(GLsizei n, const GLuint* names) { c().record(TraceOp::DeleteQueries, {a(n), c().names(names, n)}); O::DeleteQueries(n, names); }
+    static GLuint APIENTRY CreateProgram() { GLuint p = O::CreateProgram(); c().record(TraceOp::CreateProgram, {a(p)}); return p; }
+    static void APIENTRY DeleteProgram(GLuint program) { c().record(TraceOp::DeleteProgram, {a(program)}); O::DeleteProgram(program); }
+    static GLuint APIENTRY CreateShader(GLenum type) { GLuint s = O::CreateShader(type); c().record(TraceOp::CreateShader, {a(type), a(s)}); return s; }
+    static void APIENTRY DeleteShader(GLuint shader) { c().record(TraceOp::DeleteShader, {a(shader)}); O::DeleteShader(shader); }
+
+    // Shaders
+    static void APIENTRY ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+        std::string source;
+        for (GLsizei i {}; i < count; i++) {
+            if (lengths && lengths[i] >= 0) source.append(strings[i], lengths[i]);
+            else source.append(strings[i]);
+        }
+        c().record(TraceOp::ShaderSource, {a(shader), c().blob(source.data(), source.size()), source.size()});
+        O::ShaderSource(shader, count, strings, lengths);
+    }
+    static void APIENTRY CompileShader(GLuint shader) { c().record(TraceOp::CompileShader, {a(shader)}); O::CompileShader(shader); }
+    static void APIENTRY AttachShader(GLuint program, GLuint shader) { c().record(TraceOp::AttachShader, {a(program), a(shader)}); O::AttachShader(program, shader); }
+    static void APIENTRY LinkProgram(GLuint program) { c().record(TraceOp::LinkProgram, {a(program)}); O::LinkProgram(program); }
+    // Names are stored back to back, each with its terminator
+    static void APIENTRY TransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar* const* varyings, GLenum mode) {
+        std::string names;
+        for (GLsizei i {}; i < count; i++) names.append(varyings[i], std::strlen(varyings[i]) + 1);
+        c().record(TraceOp::TransformFeedbackVaryings, {a(program), a(count), c().blob(names.data(), names.size()), names.size(), a(mode)});
+        O::TransformFeedbackVaryings(program, count, varyings, mode);
+    }
+    static GLint APIENTRY GetUniformLocation(GLuint program, const GLchar* name) {
+        GLint location = O::GetUniformLocation(program, name);
+        u64 length = std::strlen(name);
+        c().record(TraceOp::GetUniformLocation, {a(program), c().blob(name, length), length, a(location)});
+        return location;
+    }
+
+    // Binds
+    static void APIENTRY UseProgram(GLuint program) { c().record(TraceOp::UseProgram, {a(program)}); O::UseProgram(program); }
+    static void APIENTRY BindBuffer(GLenum target, GLuint buffer) {
+        if (target == GL_PIXEL_UNPACK_BUFFER) c().unpackBuffer(buffer);
+        c().record(TraceOp::BindBuffer, {a(target), a(buffer)});
+        O::BindBuffer(target, buffer);
+    }
+    static void APIENTRY BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) { c().record(TraceOp::BindBufferRange, {a(target), a(index), a(buffer), a(offset), a(size)}); O::BindBufferRange(target, index, buffer, offset, size); }
+    static void APIENTRY BindVertexArray(GLuint array) { c().record(TraceOp::BindVertexArray, {a(array)}); O::BindVertexArray(array); }
+    static void APIENTRY ActiveTexture(GLenum unit) { c().record(TraceOp::ActiveTexture, {a(unit)}); O::ActiveTexture(unit); }
+    static void APIENTRY BindBufferBase(GLenum target, GLuint index, GLuint buffer) { c().record(TraceOp::BindBufferBase, {a(target), a(index), a(buffer)}); O::BindBufferBase(target, index, buffer); }
+    static void APIENTRY BindTransformFeedback(GLenum target, GLuint feedback) { c().record(TraceOp::BindTransformFeedback, {a(target), a(feedback)}); O::BindTransformFeedback(target, feedback); }
+    static void APIENTRY TransformFeedbackBufferBase(GLuint feedback, GLuint index, GLuint buffer) { c().record(TraceOp::TransformFeedbackBufferBase, {a(feedback), a(index), a(buffer)}); O::TransformFeedbackBufferBase(feedback, index, buffer); }
+    static void APIENTRY BindTexture(GLenum target, GLuint texture) { c().record(TraceOp::BindTexture, {a(target), a(texture)}); O::BindTexture(target, texture); }
+    static void APIENTRY BindFramebuffer(GLenum target, GLuint framebuffer) { c().record(TraceOp::BindFramebuffer, {a(target), a(framebuffer)}); O::BindFramebuffer(target, framebuffer); }
+
+    // Uniforms
+    static void APIENTRY Uniform1i(GLint location, GLint v0) { c().record(TraceOp::Uniform1i, {a(location), a(v0)}); O::Uniform1i(location, v0); }
+    static void APIENTRY Uniform1f(GLint location, GLfloat v0) { c().record(TraceOp::Uniform1f, {a(location), a(v0)}); O::Uniform1f(location, v0); }
+    static void APIENTRY Uniform1iv(GLint location, GLsizei count, const GLint* v) { c().record(TraceOp::Uniform1iv, {a(location), a(count), c().blob(v, count * sizeof(i32))}); O::Uniform1iv(location, count, v); }
+    static void APIENTRY Uniform1fv(GLint location, GLsizei count, const GLfloat* v) { c().record(TraceOp::Uniform1fv, {a(location), a(count), c().blob(v, count * sizeof(float))}); O::Uniform1fv(location, count, v); }
+    static void APIENTRY Uniform2fv(GLint location, GLsizei count, const GLfloat* v) { c().record(TraceOp::Uniform2fv, {a(location), a(count), c().blob(v, count * 2 * sizeof(float))}); O::Uniform2fv(location, count, v); }
+    static void APIENTRY Uniform3fv(GLint location, GLsizei count, const GLfloat* v) { c().record(TraceOp::Uniform3fv, {a(location), a(count), c().blob(v, count * 3 * sizeof(float))}); O::Uniform3fv(location, count, v); }
+    static void APIENTRY Uniform4fv(GLint location, GLsizei count, const GLfloat* v) { c().record(TraceOp::Uniform4fv, {a(location), a(count), c().blob(v, count * 4 * sizeof(float))}); O::Uniform4fv(location, count, v); }
+    static void APIENTRY Uniform2uiv(GLint location, GLsizei count, const GLuint* v) { c().record(TraceOp::Uniform2uiv, {a(location), a(count), c().blob(v, count * 2 * sizeof(u32))}); O::Uniform2uiv(location, count, v); }
+    static void APIENTRY UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* v) { c().record(TraceOp::UniformMatrix3fv, {a(location), a(count), a(transpose), c().blob(v, count * 9 * sizeof(float))}); O::UniformMatrix3fv(location, count, transpose, v); }
+    static void APIENTRY UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* v) { c().record(TraceOp::UniformMatrix4fv, {a(location), a(count), a(transpose), c().blob(v, count * 16 * sizeof(float))}); O::UniformMatrix4fv(location, count, transpose, v); }
+
+    // Buffer uploads
+    static void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) { c().record(TraceOp::BufferData, {a(target), a(size), c().blob(data, size), a(usage)}); O::BufferData(target, size, data, usage); }
+    static void APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) { c().record(TraceOp::BufferSubData, {a(target), a(offset), a(size), c().blob(data, size)}); O::BufferSubData(target, offset, size, data); }
+    static void APIENTRY BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) { c().record(TraceOp::BufferStorage, {a(target), a(size), c().blob(data, size), a(flags)}); O::BufferStorage(target, size, data, flags); }
+    static void APIENTRY NamedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) { c().record(TraceOp::NamedBufferData, {a(buffer), a(size), c().blob(data, size), a(usage)}); O::NamedBufferData(buffer, size, data, usage); }
+    static void APIENTRY NamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) { c().record(TraceOp::NamedBufferSubData, {a(buffer), a(offset), a(size), c().blob(data, size)}); O::NamedBufferSubData(buffer, offset, size, data); }
+    static void APIENTRY NamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags) { c().record(TraceOp::NamedBufferStorage, {a(buffer), a(size), c().blob(data, size), a(flags)}); O::NamedBufferStorage(buffer, size, data, flags); }
+
+    // Mapped ranges are keyed by target, or by name for the named calls
+    static constexpr u64 named = 1ull << 32;
+
+    static void* APIENTRY MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        void* data = O::MapBufferRange(target, offset, length, access);
+        c().record(TraceOp::MapBufferRange, {a(target), a(offset), a(length), a(access)});
+        c().mapped(target, data, length, access);
+        return data;
+    }
+    static void* APIENTRY MapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        void* data = O::MapNamedBufferRange(buffer, offset, length, access);
+        c().record(TraceOp::MapNamedBufferRange, {a(buffer), a(offset), a(length), a(access)});
+        c().mapped(named | buffer, data, length, access);
+        return data;
+    }
+    static void APIENTRY FlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length) { c().record(TraceOp::FlushMappedBufferRange, {a(target), a(offset), a(length), c().flushed(target, offset, length)}); O::FlushMappedBufferRange(target, offset, length); }
+    static void APIENTRY FlushMappedNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length) { c().record(TraceOp::FlushMappedNamedBufferRange, {a(buffer), a(offset), a(length), c().flushed(named | buffer, offset, length)}); O::FlushMappedNamedBufferRange(buffer, offset, length); }
+    static GLboolean APIENTRY UnmapBuffer(GLenum target) { c().record(TraceOp::UnmapBuffer, {a(target), c().unmapped(target)}); return O::UnmapBuffer(target); }
+    static GLboolean APIENTRY UnmapNamedBuffer(GLuint buffer) { c().record(TraceOp::UnmapNamedBuffer, {a(buffer), c().unmapped(named | buffer)}); return O::UnmapNamedBuffer(buffer); }
+
+    // Texture uploads
+    static void APIENTRY PixelStorei(GLenum pname, GLint param) {
+        if (pname == GL_UNPACK_ALIGNMENT) c().unpackAlignment(param);
+        c().record(TraceOp::PixelStorei, {a(pname), a(param)});
+        O::PixelStorei(pname, param);
+    }
+    static void APIENTRY TexImage1D(GLenum target, GLint level, GLint internalformat, GLsizei w, GLint border, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, 1, 1, f);
+        c().record(TraceOp::TexImage1D, {a(target), a(level), a(internalformat), a(w), a(border), a(format), a(type), p}, f);
+        O::TexImage1D(target, level, internalformat, w, border, format, type, pixels);
+    }
+    static void APIENTRY TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei w, GLsizei h, GLint border, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, h, 1, f);
+        c().record(TraceOp::TexImage2D, {a(target), a(level), a(internalformat), a(w), a(h), a(border), a(format), a(type), p}, f);
+        O::TexImage2D(target, level, internalformat, w, h, border, format, type, pixels);
+    }
+    static void APIENTRY TexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei w, GLsizei h, GLsizei d, GLint border, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, h, d, f);
+        c().record(TraceOp::TexImage3D, {a(target), a(level), a(internalformat), a(w), a(h), a(d), a(border), a(format), a(type), p}, f);
+        O::TexImage3D(target, level, internalformat, w, h, d, border, format, type, pixels);
+    }
+    static void APIENTRY TexSubImage1D(GLenum target, GLint level, GLint x, GLsizei w, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, 1, 1, f);
+        c().record(TraceOp::TexSubImage1D, {a(target), a(level), a(x), a(w), a(format), a(type), p}, f);
+        O::TexSubImage1D(target, level, x, w, format, type, pixels);
+    }
+    static void APIENTRY TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei w, GLsizei h, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, h, 1, f);
+        c().record(TraceOp::TexSubImage2D, {a(target), a(level), a(x), a(y), a(w), a(h), a(format), a(type), p}, f);
+        O::TexSubImage2D(target, level, x, y, w, h, format, type, pixels);
+    }
+    static void APIENTRY TexSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei w, GLsizei h, GLsizei d, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, h, d, f);
+        c().record(TraceOp::TexSubImage3D, {a(target), a(level), a(x), a(y), a(z), a(w), a(h), a(d), a(format), a(type), p}, f);
+        O::TexSubImage3D(target, level, x, y, z, w, h, d, format, type, pixels);
+    }
+    static void APIENTRY TextureSubImage1D(GLuint texture, GLint level, GLint x, GLsizei w, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, 1, 1, f);
+        c().record(TraceOp::TextureSubImage1D, {a(texture), a(level), a(x), a(w), a(format), a(type), p}, f);
+        O::TextureSubImage1D(texture, level, x, w, format, type, pixels);
+    }
+    static void APIENTRY TextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei w, GLsizei h, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, h, 1, f);
+        c().record(TraceOp::TextureSubImage2D, {a(texture), a(level), a(x), a(y), a(w), a(h), a(format), a(type), p}, f);
+        O::TextureSubImage2D(texture, level, x, y, w, h, format, type, pixels);
+    }
+    static void APIENTRY TextureSubImage3D(GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei w, GLsizei h, GLsizei d, GLenum format, GLenum type, const void* pixels) {
+        u8 f {};
+        u64 p = c().pixels(pixels, format, type, w, h, d, f);
+        c().record(TraceOp::TextureSubImage3D, {a(texture), a(level), a(x), a(y), a(z), a(w), a(h), a(d), a(format), a(type), p}, f);
+        O::TextureSubImage3D(texture, level, x, y, z, w, h, d, format, type, pixels);
+    }
+    static void APIENTRY TexBuffer(GLenum target, GLenum format, GLuint buffer) { c().record(TraceOp::TexBuffer, {a(target), a(format), a(buffer)}); O::TexBuffer(target, format, buffer); }
+    static void APIENTRY TextureBuffer(GLuint texture, GLenum format, GLuint buffer) { c().record(TraceOp::TextureBuffer, {a(texture), a(format), a(buffer)}); O::TextureBuffer(texture, format, buffer); }
+
+    // Vertex layout and attachments; core profile pointers are buffer offsets
+    static void APIENTRY VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) { c().record(TraceOp::VertexAttribPointer, {a(index), a(size), a(type), a(normalized), a(stride), a(pointer)}); O::VertexAttribPointer(index, size, type, normalized, stride, pointer); }
+    static void APIENTRY VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer) { c().record(TraceOp::VertexAttribIPointer, {a(index), a(size), a(type), a(stride), a(pointer)}); O::VertexAttribIPointer(index, size, type, stride, pointer); }
+    static void APIENTRY EnableVertexAttribArray(GLuint index) { c().record(TraceOp::EnableVertexAttribArray, {a(index)}); O::EnableVertexAttribArray(index); }
+    static void APIENTRY VertexAttribDivisor(GLuint index, GLuint divisor) { c().record(TraceOp::VertexAttribDivisor, {a(index), a(divisor)}); O::VertexAttribDivisor(index, divisor); }
+    static void APIENTRY VertexArrayVertexBuffer(GLuint vao, GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride) { c().record(TraceOp::VertexArrayVertexBuffer, {a(vao), a(binding), a(buffer), a(offset), a(stride)}); O::VertexArrayVertexBuffer(vao, binding, buffer, offset, stride); }
+    static void APIENTRY VertexArrayAttribFormat(GLuint vao, GLuint index, GLint size, GLenum type, GLboolean normalized, GLuint offset) { c().record(TraceOp::VertexArrayAttribFormat, {a(vao), a(index), a(size), a(type), a(normalized), a(offset)}); O::VertexArrayAttribFormat(vao, index, size, type, normalized, offset); }
+    static void APIENTRY VertexArrayAttribBinding(GLuint vao, GLuint index, GLuint binding) { c().record(TraceOp::VertexArrayAttribBinding, {a(vao), a(index), a(binding)}); O::VertexArrayAttribBinding(vao, index, binding); }
+    static void APIENTRY EnableVertexArrayAttrib(GLuint vao, GLuint index) { c().record(TraceOp::EnableVertexArrayAttrib, {a(vao), a(index)}); O::EnableVertexArrayAttrib(vao, index); }
+    static void APIENTRY VertexArrayBindingDivisor(GLuint vao, GLuint binding, GLuint divisor) { c().record(TraceOp::VertexArrayBindingDivisor, {a(vao), a(binding), a(divisor)}); O::VertexArrayBindingDivisor(vao, binding, divisor); }
+    static void APIENTRY VertexArrayElementBuffer(GLuint vao, GLuint buffer) { c().record(TraceOp::VertexArrayElementBuffer, {a(vao), a(buffer)}); O::VertexArrayElementBuffer(vao, buffer); }
+    static void APIENTRY FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) { c().record(TraceOp::FramebufferTexture2D, {a(target), a(attachment), a(textarget), a(texture), a(level)}); O::FramebufferTexture2D(target, attachment, textarget, texture, level); }
+    static void APIENTRY NamedFramebufferTexture(GLuint framebuffer, GLenum attachment, GLuint texture, GLint level) { c().record(TraceOp::NamedFramebufferTexture, {a(framebuffer), a(attachment), a(texture), a(level)}); O::NamedFramebufferTexture(framebuffer, attachment, texture, level); }
+
+    // State
+    static void APIENTRY Enable(GLenum cap) { c().record(TraceOp::Enable, {a(cap)}); O::Enable(cap); }
+    static void APIENTRY Disable(GLenum cap) { c().record(TraceOp::Disable, {a(cap)}); O::Disable(cap); }
+    static void APIENTRY BlendFunc(GLenum src, GLenum dst) { c().record(TraceOp::BlendFunc, {a(src), a(dst)}); O::BlendFunc(src, dst); }
+    static void APIENTRY DepthFunc(GLenum func) { c().record(TraceOp::DepthFunc, {a(func)}); O::DepthFunc(func); }
+    static void APIENTRY Viewport(GLint x, GLint y, GLsizei w, GLsizei h) { c().record(TraceOp::Viewport, {a(x), a(y), a(w), a(h)}); O::Viewport(x, y, w, h); }
+    static void APIENTRY ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat al) { c().record(TraceOp::ClearColor, {a(r), a(g), a(b), a(al)}); O::ClearColor(r, g, b, al); }
+    static void APIENTRY ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean al) { c().record(TraceOp::ColorMask, {a(r), a(g), a(b), a(al)}); O::ColorMask(r, g, b, al); }
+    static void APIENTRY DepthMask(GLboolean flag) { c().record(TraceOp::DepthMask, {a(flag)}); O::DepthMask(flag); }
+    static void APIENTRY TexParameteri(GLenum target, GLenum pname, GLint param) { c().record(TraceOp::TexParameteri, {a(target), a(pname), a(param)}); O::TexParameteri(target, pname, param); }
+    static void APIENTRY TexParameterf(GLenum target, GLenum pname, GLfloat param) { c().record(TraceOp::TexParameterf, {a(target), a(pname), a(param)}); O::TexParameterf(target, pname, param); }
+    static void APIENTRY TextureParameteri(GLuint texture, GLenum pname, GLint param) { c().record(TraceOp::TextureParameteri, {a(texture), a(pname), a(param)}); O::TextureParameteri(texture, pname, param); }
+    static void APIENTRY TextureParameterf(GLuint texture, GLenum pname, GLfloat param) { c().record(TraceOp::TextureParameterf, {a(texture), a(pname), a(param)}); O::TextureParameterf(texture, pname, param); }
+
+    // Draws
+    static void APIENTRY Clear(GLbitfield mask) { c().record(TraceOp::Clear, {a(mask)}); O::Clear(mask); }
+    static void APIENTRY DrawArrays(GLenum mode, GLint first, GLsizei count) { c().record(TraceOp::DrawArrays, {a(mode), a(first), a(count)}); O::DrawArrays(mode, first, count); }
+    static void APIENTRY DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) { c().record(TraceOp::DrawArraysInstanced, {a(mode), a(first), a(count), a(instances)}); O::DrawArraysInstanced(mode, first, count, instances); }
+    static void APIENTRY DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) { c().record(TraceOp::DrawElements, {a(mode), a(count), a(type), a(indices)}); O::DrawElements(mode, count, type, indices); }
+    static void APIENTRY DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances) { c().record(TraceOp::DrawElementsInstanced, {a(mode), a(count), a(type), a(indices), a(instances)}); O::DrawElementsInstanced(mode, count, type, indices, instances); }
+    static void APIENTRY BeginTransformFeedback(GLenum mode) { c().record(TraceOp::BeginTransformFeedback, {a(mode)}); O::BeginTransformFeedback(mode); }
+    static void APIENTRY EndTransformFeedback() { c().record(TraceOp::EndTransformFeedback, {}); O::EndTransformFeedback(); }
+    static void APIENTRY BeginQuery(GLenum target, GLuint query) { c().record(TraceOp::BeginQuery, {a(target), a(query)}); O::BeginQuery(target, query); }
+    static void APIENTRY EndQuery(GLenum target) { c().record(TraceOp::EndQuery, {a(target)}); O::EndQuery(target); }
+    static void APIENTRY BeginConditionalRender(GLuint query, GLenum mode) { c().record(TraceOp::BeginConditionalRender, {a(query), a(mode)}); O::BeginConditionalRender(query, mode); }
+    static void APIENTRY EndConditionalRender() { c().record(TraceOp::EndConditionalRender, {}); O::EndConditionalRender(); }
+
+    // Syncs are identified by their handle value
+    static GLsync APIENTRY FenceSync(GLenum condition, GLbitfield flags) { GLsync s = O::FenceSync(condition, flags); c().record(TraceOp::FenceSync, {a(condition), a(flags), a(s)}); return s; }
+    static GLenum APIENTRY ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) { c().record(TraceOp::ClientWaitSync, {a(sync), a(flags), timeout}); return O::ClientWaitSync(sync, flags, timeout); }
+    static void APIENTRY DeleteSync(GLsync sync) { c().record(TraceOp::DeleteSync, {a(sync)}); O::DeleteSync(sync); }
+    // Polls keep their cost in the replay; the values aren't recorded
+    static void APIENTRY GetQueryObjectuiv(GLuint query, GLenum pname, GLuint* params) { c().record(TraceOp::GetQueryObjectuiv, {a(query), a(pname)}); O::GetQueryObjectuiv(query, pname, params); }
+};
+
+// Functions the driver doesn't expose keep their null pointer
+inline void GLCapture::install() {
+#define X(name, category) \
+    TraceOriginals::name = glad_gl##name; \
+    if (glad_gl##name) glad_gl##name = &TraceThunks::name;
+    GLABS_TRACE_CALLS(X)
+#undef X
+}
+
+inline void GLCapture::restore() {
+#define X(name, category) glad_gl##name = TraceOriginals::name;
+    GLABS_TRACE_CALLS(X)
+#undef X
+}
+
+inline bool GLCapture::start(const char* path) {
+    if (m_file || gl_capture) {
+        logDebug("Trace: a capture is already running");
+        return false;
+    }
+    m_file = std::fopen(path, "wb");
+    if (!m_file) {
+        logDebug("Trace: could not open %s", path);
+        return false;
+    }
+    std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+    TraceHeader header {{'G', 'L', 'B', 'T'}, traceVersion};
+    std::fwrite(&header, sizeof(header), 1, m_file);
+
+    m_blobs.clear();
+    m_maps.clear();
+    m_stats = {};
+    m_thread = std::this_thread::get_id();
+    m_unpackAlignment = 4;
+    m_unpackBuffer = 0;
+    m_bufferStorage = buffer_storage_enabled;
+    buffer_storage_enabled = false;
+    gl_capture = this;
+    install();
+    logDebug("Trace: capturing to %s", path);
+    return true;
+}
+
+inline void GLCapture::stop() {
+    if (!m_file) return;
+    restore();
+    gl_capture = nullptr;
+    buffer_storage_enabled = m_bufferStorage;
+    std::lock_guard lock(m_mutex);
+    std::fclose(m_file);
+    m_file = nullptr;
+    logDebug("Trace: %llu calls, %llu frames, %llu blob bytes", (unsigned long long) m_stats.calls, (unsigned long long) m_stats.frames, (unsigned long long) m_stats.blobBytes);
+    if (m_stats.ignoredCalls) logDebug("Trace: %llu calls from other threads were not recorded", (unsigned long long) m_stats.ignoredCalls);
+}
+
+struct ReplayOptions {
+    bool skipState {};      // Drop TraceCategory::State calls
+    bool skipDraws {};      // Drop clears and draws
+    bool skipUniforms {};
+    bool finishFrames {true};   // glFinish at frame markers so frame times include the GPU
+    bool timeCalls {true};
+};
+
+struct ReplayOpStats {
+    u64 calls {};
+    u64 ns {};
+};
+
+struct ReplayStats {
+    std::vector<u64> frameNs;
+    ReplayOpStats ops[traceOpCount] {};
+    u64 calls {};
+    u64 skipped {};
+};
+
+// Re-executes a .glbt trace on the current context. Object names, syncs and
+// uniform locations are remapped, so the replay context may hand out
+// different ones than the captured run did.
+class GLReplay {
+    struct Call {
+        TraceOp op;
+        u8 flags;
+        u8 argc;
+        u32 first;  // Index of the first argument in m_args
+    };
+
+    struct Map {
+        u8* data;
+        u64 length;
+    };
+
+    enum NameKind : u32 {
+        Buffers,
+        Textures,
+        VertexArrays,
+        Framebuffers,
+        Programs,
+        Shaders,
+        TransformFeedbacks,
+        Queries,
+        NameKinds
+    };
+
+    MappedFile m_file;
+    std::vector<Call> m_calls;
+    std::vector<u64> m_args;
+    std::unordered_map<u64, const u8*> m_blobs;
+    u32 m_frames {};
+
+    std::unordered_map<u32, u32> m_names[NameKinds];
+    std::unordered_map<u64, GLsync> m_syncs;
+    std::unordered_map<u64, GLint> m_locations;
+    std::unordered_map<u64, Map> m_maps;
+    u32 m_program {};
+
+    static inline float f(u64 v) {
+        return std::bit_cast<float>(static_cast<u32>(v));
+    }
+
+    inline const void* blob(u64 hash) const {
+        if (!hash) return nullptr;
+        auto it = m_blobs.find(hash);
+        return it == m_blobs.end() ? nullptr : it->second;
+    }
+
+    // Pixel pointer: a blob, or an offset into the bound unpack buffer
+    inline const void* pixels(const Call& call, u64 v) const {
+        if (call.flags & traceFlagOffset) return reinterpret_cast<const void*>(static_cast<std::uintptr_t>(v));
+        return blob(v);
+    }
+
+    // Names created before the capture started are used as they are
+    inline u32 name(NameKind kind, u64 recorded) const {
+        if (!recorded) return 0;
+        auto it = m_names[kind].find(static_cast<u32>(recorded));
+        return it == m_names[kind].end() ? static_cast<u32>(recorded) : it->second;
+    }
+
+    inline GLint location(u64 recorded) const {
+        GLint loc = static_cast<GLint>(recorded);
+        auto it = m_locations.find((u64(m_program) << 32) | static_cast<u32>(loc));
+        return it == m_locations.end() ? loc : it->second;
+    }
+
+    template<typename F>
+    inline void create(NameKind kind, u64 n, u64 recorded, F&& make) {
+        std::vector<u32> fresh(n);
+        make(static_cast<GLsizei>(n), fresh.data());
+        auto* old = static_cast<const u32*>(blob(recorded));
+        for (u64 i {}; old && i < n; i++) m_names[kind][old[i]] = fresh[i];
+    }
+
+    template<typename F>
+    inline void destroy(NameKind kind, u64 n, u64 recorded, F&& remove) {
+        std::vector<u32> names(n);
+        auto* old = static_cast<const u32*>(blob(recorded));
+        for (u64 i {}; old && i < n; i++) {
+            names[i] = name(kind, old[i]);
+            m_names[kind].erase(old[i]);
+        }
+        remove(static_cast<GLsizei>(n), names.data());
+    }
+
+    inline void map(u64 key, void* data, u64 length) {
+        if (data) m_maps[key] = {static_cast<u8*>(data), length};
+    }
+
+    inline void write(u64 key, u64 offset, u64 length, u64 hash) {
+        auto it = m_maps.find(key);
+        const void* data = blob(hash);
+        if (it != m_maps.end() && data) std::memcpy(it->second.data + offset, data, length);
+    }
+
+    inline void unmap(u64 key, u64 hash) {
+        auto it = m_maps.find(key);
+        if (it == m_maps.end()) return;
+        write(key, 0, it->second.length, hash);
+        m_maps.erase(it);
+    }
+
+    static constexpr u64 named = 1ull << 32;
+
+    inline void execute(const Call& call);
+
+public:
+    GLReplay() = default;
+    GLReplay(const GLReplay&) = delete;
+    GLReplay& operator=(const GLReplay&) = delete;
+
+    inline bool open(const char* path);
+
+    // Runs the whole trace once. Returns per-frame and per-call timings.
+    inline ReplayStats run(const ReplayOptions& options = {});
+
+    // Deletes every object the replay created, so the trace can run again
+    inline void release();
+
+    inline u32 frames() const { return m_frames; }
+    inline u64 calls() const { return m_calls.size(); }
+
+    inline ~GLReplay() {
+        m_file.close();
+    }
+};
+
+inline bool GLReplay::open(const char* path) {
+    m_calls.clear();
+    m_args.clear();
+    m_blobs.clear();
+    m_frames = 0;
+    if (!m_file.open(path)) {
+        logDebug("Replay %s: could not map file", path);
+        return false;
+    }
+    const u8* p = m_file.data();
+    const u8* end = p + m_file.size();
+    TraceHeader header;
+    if (m_file.size() < sizeof(header)) return false;
+    std::memcpy(&header, p, sizeof(header));
+    if (std::memcmp(header.magic, "GLBT", 4) != 0 || header.version != traceVersion) {
+        logDebug("Replay %s: not a version %d trace", path, traceVersion);
+        return false;
+    }
+    p += sizeof(header);
+
+    while (p + 4 <= end) {
+        u16 code;
+        std::memcpy(&code, p, 2);
+        Call call {static_cast<TraceOp>(code), p[3], p[2], static_cast<u32>(m_args.size())};
+        p += 4;
+        if (code >= traceOpCount || p + call.argc * sizeof(u64) > end) {
+            logDebug("Replay %s: corrupt record", path);
+            return false;
+        }
+        for (u32 i {}; i < call.argc; i++, p += sizeof(u64)) {
+            u64 v;
+            std::memcpy(&v, p, sizeof(v));
+            m_args.push_back(v);
+        }
+        if (call.op == TraceOp::Blob) {
+            u64 hash = m_args[call.first];
+            u64 size = m_args[call.first + 1];
+            m_args.resize(call.first);
+            if (p + size > end) {
+                logDebug("Replay %s: truncated blob", path);
+                return false;
+            }
+            m_blobs[hash] = p;
+            p += size;
+            continue;
+        }
+        if (call.op == TraceOp::Frame) m_frames++;
+        m_calls.push_back(call);
+    }
+    logDebug("Replay %s: %llu calls, %d frames, %llu blobs", path, (unsigned long long) m_calls.size(), m_frames, (unsigned long long) m_blobs.size());
+    return true;
+}
+
+inline ReplayStats GLReplay::run(const ReplayOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    auto ns = [](Clock::time_point a, Clock::time_point b) {
+        return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count());
+    };
+
+    ReplayStats stats;
+    stats.frameNs.reserve(m_frames);
+    auto frameStart = Clock::now();
+    for (const Call& call : m_calls) {
+        if (call.op == TraceOp::Frame) {
+            if (options.finishFrames) glFinish();
+            auto now = Clock::now();
+            stats.frameNs.push_back(ns(frameStart, now));
+            frameStart = now;
+            continue;
+        }
+        TraceCategory category = traceCategory[static_cast<u32>(call.op)];
+        if ((options.skipState && category == TraceCategory::State) ||
+            (options.skipDraws && category == TraceCategory::Draw) ||
+            (options.skipUniforms && category == TraceCategory::Uniform)) {
+            stats.skipped++;
+            continue;
+        }
+        auto& op = stats.ops[static_cast<u32>(call.op)];
+        op.calls++;
+        stats.calls++;
+        if (options.timeCalls) {
+            auto start = Clock::now();
+            execute(call);
+            op.ns += ns(start, Clock::now());
+        } else {
+            execute(call);
+        }
+    }
+    return stats;
+}
+
+inline void GLReplay::release() {
+    auto names = [&](NameKind kind) {
+        std::vector<u32> v;
+        for (auto& [recorded, name] : m_names[kind]) v.push_back(name);
+        m_names[kind].clear();
+        return v;
+    };
+    auto v = names(Buffers);
+    glDeleteBuffers(v.size(), v.data());
+    v = names(Textures);
+    glDeleteTextures(v.size(), v.data());
+    v = names(VertexArrays);
+    glDeleteVertexArrays(v.size(), v.data());
+    v = names(Framebuffers);
+    glDeleteFramebuffers(v.size(), v.data());
+    v = names(TransformFeedbacks);
+    glDeleteTransformFeedbacks(v.size(), v.data());
+    v = names(Queries);
+    glDeleteQueries(v.size(), v.data());
+    for (u32 p : names(Programs)) glDeleteProgram(p);
+    for (u32 s : names(Shaders)) glDeleteShader(s);
+    for (auto& [id, sync] : m_syncs) glDeleteSync(sync);
+    m_syncs.clear();
+    m_locations.clear();
+    m_maps.clear();
+    m_program = 0;
+}
+
+inline void GLReplay::execute(const Call& call) {
+    const u64* a = m_args.data() + call.first;
+    switch (call.op) {
+    // Objects
+    case TraceOp::GenBuffers:         create(Buffers, a[0], a[1], glGenBuffers); break;
+    case TraceOp::CreateBuffers:      create(Buffers, a[0], a[1], glCreateBuffers); break;
+    case TraceOp::DeleteBuffers:      destroy(Buffers, a[0], a[1], glDeleteBuffers); break;
+    case TraceOp::GenTextures:        create(Textures, a[0], a[1], glGenTextures); break;
+    case TraceOp::CreateTextures:
+        create(Textures, a[1], a[2], [&](GLsizei n, GLuint* names) { glCreateTextures(a[0], n, names); });
+        break;
+    case TraceOp::DeleteTextures:     destroy(Textures, a[0], a[1], glDeleteTextures); break;
+    case TraceOp::GenVertexArrays:    create(VertexArrays, a[0], a[1], glGenVertexArrays); break;
+    case TraceOp::CreateVertexArrays: create(VertexArrays, a[0], a[1], glCreateVertexArrays); break;
+    case TraceOp::DeleteVertexArrays: destroy(VertexArrays, a[0], a[1], glDeleteVertexArrays); break;
+    case TraceOp::GenFramebuffers:    create(Framebuffers, a[0], a[1], glGenFramebuffers); break;
+    case TraceOp::CreateFramebuffers: create(Framebuffers, a[0], a[1], glCreateFramebuffers); break;
+    case TraceOp::DeleteFramebuffers: destroy(Framebuffers, a[0], a[1], glDeleteFramebuffers); break;
+    case TraceOp::GenTransformFeedbacks:    create(TransformFeedbacks, a[0], a[1], glGenTransformFeedbacks); break;
+    case TraceOp::CreateTransformFeedbacks: create(TransformFeedbacks, a[0], a[1], glCreateTransformFeedbacks); break;
+    case TraceOp::DeleteTransformFeedbacks: destroy(TransformFeedbacks, a[0], a[1], glDeleteTransformFeedbacks); break;
+    case TraceOp::GenQueries:         create(Queries, a[0], a[1], glGenQueries); break;
+    case TraceOp::CreateQueries:
+        create(Queries, a[1], a[2], [&](GLsizei n, GLuint* names) { glCreateQueries(a[0], n, names); });
+        break;
+    case TraceOp::DeleteQueries:      destroy(Queries, a[0], a[1], glDeleteQueries); break;
+    case TraceOp::CreateProgram:      m_names[Programs][a[0]] = glCreateProgram(); break;
+    case TraceOp::DeleteProgram:
+        glDeleteProgram(name(Programs, a[0]));
+        m_names[Programs].erase(a[0]);
+        break;
+    case TraceOp::CreateShader:       m_names[Shaders][a[1]] = glCreateShader(a[0]); break;
+    case TraceOp::DeleteShader:
+        glDeleteShader(name(Shaders, a[0]));
+        m_names[Shaders].erase(a[0]);
+        break;
+
+    // Shaders
+    case TraceOp::ShaderSource: {
+        auto* source = static_cast<const GLchar*>(blob(a[1]));
+        GLint length = static_cast<GLint>(a[2]);
+        if (source) glShaderSource(name(Shaders, a[0]), 1, &source, &length);
+        break;
+    }
+    case TraceOp::CompileShader:      glCompileShader(name(Shaders, a[0])); break;
+    case TraceOp::AttachShader:       glAttachShader(name(Programs, a[0]), name(Shaders, a[1])); break;
+    case TraceOp::LinkProgram:        glLinkProgram(name(Programs, a[0])); break;
+    case TraceOp::TransformFeedbackVaryings: {
+        auto* chars = static_cast<const GLchar*>(blob(a[2]));
+        if (!chars) break;
+        std::vector<const GLchar*> varyings;
+        for (u64 at {}; at < a[3] && varyings.size() < a[1]; at += std::strlen(chars + at) + 1) varyings.push_back(chars + at);
+        glTransformFeedbackVaryings(name(Programs, a[0]), varyings.size(), varyings.data(), a[4]);
+        break;
+    }
+    case TraceOp::GetUniformLocation: {
+        auto* chars = static_cast<const char*>(blob(a[1]));
+        GLint recorded = static_cast<GLint>(a[3]);
+        if (!chars || recorded < 0) break;
+        std::string uniform(chars, a[2]);
+        m_locations[(a[0] << 32) | static_cast<u32>(recorded)] = glGetUniformLocation(name(Programs, a[0]), uniform.c_str());
+        break;
+    }
+
+    // Binds
+    case TraceOp::UseProgram:
+        m_program = a[0];
+        glUseProgram(name(Programs, a[0]));
+        break;
+    case TraceOp::BindBuffer:         glBindBuffer(a[0], name(Buffers, a[1])); break;
+    case TraceOp::BindBufferRange:    glBindBufferRange(a[0], a[1], name(Buffers, a[2]), a[3], a[4]); break;
+    case TraceOp::BindBufferBase:     glBindBufferBase(a[0], a[1], name(Buffers, a[2])); break;
+    case TraceOp::BindTransformFeedback:       glBindTransformFeedback(a[0], name(TransformFeedbacks, a[1])); break;
+    case TraceOp::TransformFeedbackBufferBase: glTransformFeedbackBufferBase(name(TransformFeedbacks, a[0]), a[1], name(Buffers, a[2])); break;
+    case TraceOp::BindVertexArray:    glBindVertexArray(name(VertexArrays, a[0])); break;
+    case TraceOp::ActiveTexture:      glActiveTexture(a[0]); break;
+    case TraceOp::BindTexture:        glBindTexture(a[0], name(Textures, a[1])); break;
+    case TraceOp::BindFramebuffer:    glBindFramebuffer(a[0], name(Framebuffers, a[1])); break;
+
+    // Uniforms
+    case TraceOp::Uniform1i:          glUniform1i(location(a[0]), a[1]); break;
+    case TraceOp::Uniform1f:          glUniform1f(location(a[0]), f(a[1])); break;
+    case TraceOp::Uniform1iv:         glUniform1iv(location(a[0]), a[1], static_cast<const i32*>(blob(a[2]))); break;
+    case TraceOp::Uniform1fv:         glUniform1fv(location(a[0]), a[1], static_cast<const float*>(blob(a[2]))); break;
+    case TraceOp::Uniform2fv:         glUniform2fv(location(a[0]), a[1], static_cast<const float*>(blob(a[2]))); break;
+    case TraceOp::Uniform3fv:         glUniform3fv(location(a[0]), a[1], static_cast<const float*>(blob(a[2]))); break;
+    case TraceOp::Uniform4fv:         glUniform4fv(location(a[0]), a[1], static_cast<const float*>(blob(a[2]))); break;
+    case TraceOp::Uniform2uiv:        glUniform2uiv(location(a[0]), a[1], static_cast<const u32*>(blob(a[2]))); break;
+    case TraceOp::UniformMatrix3fv:   glUniformMatrix3fv(location(a[0]), a[1], a[2], static_cast<const float*>(blob(a[3]))); break;
+    case TraceOp::UniformMatrix4fv:   glUniformMatrix4fv(location(a[0]), a[1], a[2], static_cast<const float*>(blob(a[3]))); break;
+
+    // Buffer uploads
+    case TraceOp::BufferData:         glBufferData(a[0], a[1], blob(a[2]), a[3]); break;
+    case TraceOp::BufferSubData:      glBufferSubData(a[0], a[1], a[2], blob(a[3])); break;
+    case TraceOp::BufferStorage:      glBufferStorage(a[0], a[1], blob(a[2]), a[3]); break;
+    case TraceOp::NamedBufferData:    glNamedBufferData(name(Buffers, a[0]), a[1], blob(a[2]), a[3]); break;
+    case TraceOp::NamedBufferSubData: glNamedBufferSubData(name(Buffers, a[0]), a[1], a[2], blob(a[3])); break;
+    case TraceOp::NamedBufferStorage: glNamedBufferStorage(name(Buffers, a[0]), a[1], blob(a[2]), a[3]); break;
+    case TraceOp::MapBufferRange:     map(a[0], glMapBufferRange(a[0], a[1], a[2], a[3]), a[2]); break;
+    case TraceOp::MapNamedBufferRange:
+        map(named | a[0], glMapNamedBufferRange(name(Buffers, a[0]), a[1], a[2], a[3]), a[2]);
+        break;
+    case TraceOp::FlushMappedBufferRange:
+        write(a[0], a[1], a[2], a[3]);
+        glFlushMappedBufferRange(a[0], a[1], a[2]);
+        break;
+    case TraceOp::FlushMappedNamedBufferRange:
+        write(named | a[0], a[1], a[2], a[3]);
+        glFlushMappedNamedBufferRange(name(Buffers, a[0]), a[1], a[2]);
+        break;
+    case TraceOp::UnmapBuffer:
+        unmap(a[0], a[1]);
+        glUnmapBuffer(a[0]);
+        break;
+    case TraceOp::UnmapNamedBuffer:
+        unmap(named | a[0], a[1]);
+        glUnmapNamedBuffer(name(Buffers, a[0]));
+        break;
+
+    // Texture uploads
+    case TraceOp::PixelStorei:        glPixelStorei(a[0], a[1]); break;
+    case TraceOp::TexImage1D:         glTexImage1D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], pixels(call, a[7])); break;
+    case TraceOp::TexImage2D:         glTexImage2D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], pixels(call, a[8])); break;
+    case TraceOp::TexImage3D:         glTexImage3D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], pixels(call, a[9])); break;
+    case TraceOp::TexSubImage1D:      glTexSubImage1D(a[0], a[1], a[2], a[3], a[4], a[5], pixels(call, a[6])); break;
+    case TraceOp::TexSubImage2D:      glTexSubImage2D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], pixels(call, a[8])); break;
+    case TraceOp::TexSubImage3D:      glTexSubImage3D(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], pixels(call, a[10])); break;
+    case TraceOp::TextureSubImage1D:  glTextureSubImage1D(name(Textures, a[0]), a[1], a[2], a[3], a[4], a[5], pixels(call, a[6])); break;
+    case TraceOp::TextureSubImage2D:  glTextureSubImage2D(name(Textures, a[0]), a[1], a[2], a[3], a[4], a[5], a[6], a[7], pixels(call, a[8])); break;
+    case TraceOp::TextureSubImage3D:  glTextureSubImage3D(name(Textures, a[0]), a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], pixels(call, a[10])); break;
+    case TraceOp::TexBuffer:          glTexBuffer(a[0], a[1], name(Buffers, a[2])); break;
+    case TraceOp::TextureBuffer:      glTextureBuffer(name(Textures, a[0]), a[1], name(Buffers, a[2])); break;
+
+    // Vertex layout and attachments
+    case TraceOp::VertexAttribPointer:
+        glVertexAttribPointer(a[0], a[1], a[2], a[3], a[4], reinterpret_cast<const void*>(static_cast<std::uintptr_t>(a[5])));
+        break;
+    case TraceOp::VertexAttribIPointer:
+        glVertexAttribIPointer(a[0], a[1], a[2], a[3], reinterpret_cast<const void*>(static_cast<std::uintptr_t>(a[4])));
+        break;
+    case TraceOp::EnableVertexAttribArray:   glEnableVertexAttribArray(a[0]); break;
+    case TraceOp::VertexAttribDivisor:       glVertexAttribDivisor(a[0], a[1]); break;
+    case TraceOp::VertexArrayVertexBuffer:   glVertexArrayVertexBuffer(name(VertexArrays, a[0]), a[1], name(Buffers, a[2]), a[3], a[4]); break;
+    case TraceOp::VertexArrayAttribFormat:   glVertexArrayAttribFormat(name(VertexArrays, a[0]), a[1], a[2], a[3], a[4], a[5]); break;
+    case TraceOp::VertexArrayAttribBinding:  glVertexArrayAttribBinding(name(VertexArrays, a[0]), a[1], a[2]); break;
+    case TraceOp::EnableVertexArrayAttrib:   glEnableVertexArrayAttrib(name(VertexArrays, a[0]), a[1]); break;
+    case TraceOp::VertexArrayBindingDivisor: glVertexArrayBindingDivisor(name(VertexArrays, a[0]), a[1], a[2]); break;
+    case TraceOp::VertexArrayElementBuffer:  glVertexArrayElementBuffer(name(VertexArrays, a[0]), name(Buffers, a[1])); break;
+    case TraceOp::FramebufferTexture2D:      glFramebufferTexture2D(a[0], a[1], a[2], name(Textures, a[3]), a[4]); break;
+    case TraceOp::NamedFramebufferTexture:   glNamedFramebufferTexture(name(Framebuffers, a[0]), a[1], name(Textures, a[2]), a[3]); break;
+
+    // State
+    case TraceOp::Enable:             glEnable(a[0]); break;
+    case TraceOp::Disable:            glDisable(a[0]); break;
+    case TraceOp::BlendFunc:          glBlendFunc(a[0], a[1]); break;
+    case TraceOp::DepthFunc:          glDepthFunc(a[0]); break;
+    case TraceOp::Viewport:           glViewport(a[0], a[1], a[2], a[3]); break;
+    case TraceOp::ClearColor:         glClearColor(f(a[0]), f(a[1]), f(a[2]), f(a[3])); break;
+    case TraceOp::ColorMask:          glColorMask(a[0], a[1], a[2], a[3]); break;
+    case TraceOp::DepthMask:          glDepthMask(a[0]); break;
+    case TraceOp::TexParameteri:      glTexParameteri(a[0], a[1], a[2]); break;
+    case TraceOp::TexParameterf:      glTexParameterf(a[0], a[1], f(a[2])); break;
+    case TraceOp::TextureParameteri:  glTextureParameteri(name(Textures, a[0]), a[1], a[2]); break;
+    case TraceOp::TextureParameterf:  glTextureParameterf(name(Textures, a[0]), a[1], f(a[2])); break;
+
+    // Draws
+    case TraceOp::Clear:              glClear(a[0]); break;
+    case TraceOp::DrawArrays:         glDrawArrays(a[0], a[1], a[2]); break;
+    case TraceOp::DrawArraysInstanced: glDrawArraysInstanced(a[0], a[1], a[2], a[3]); break;
+    case TraceOp::DrawElements:
+        glDrawElements(a[0], a[1], a[2], reinterpret_cast<const void*>(static_cast<std::uintptr_t>(a[3])));
+        break;
+    case TraceOp::DrawElementsInstanced:
+        glDrawElementsInstanced(a[0], a[1], a[2], reinterpret_cast<const void*>(static_cast<std::uintptr_t>(a[3])), a[4]);
+        break;
+    case TraceOp::BeginTransformFeedback: glBeginTransformFeedback(a[0]); break;
+    case TraceOp::EndTransformFeedback:   glEndTransformFeedback(); break;
+    case TraceOp::BeginQuery:             glBeginQuery(a[0], name(Queries, a[1])); break;
+    case TraceOp::EndQuery:               glEndQuery(a[0]); break;
+    case TraceOp::BeginConditionalRender: glBeginConditionalRender(name(Queries, a[0]), a[1]); break;
+    case TraceOp::EndConditionalRender:   glEndConditionalRender(); break;
+
+    // Syncs
+    case TraceOp::FenceSync:          m_syncs[a[2]] = glFenceSync(a[0], a[1]); break;
+    case TraceOp::ClientWaitSync: {
+        auto it = m_syncs.find(a[0]);
+        if (it != m_syncs.end()) glClientWaitSync(it->second, a[1], a[2]);
+        break;
+    }
+    case TraceOp::DeleteSync: {
+        auto it = m_syncs.find(a[0]);
+        if (it == m_syncs.end()) break;
+        glDeleteSync(it->second);
+        m_syncs.erase(it);
+        break;
+    }
+    case TraceOp::GetQueryObjectuiv: {
+        GLuint value {};
+        glGetQueryObjectuiv(name(Queries, a[0]), a[1], &value);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+#undef GLABS_TRACE_CALLS
+
+};
@@ -1,24 +1,68 @@
 #pragma once
 #include <cstdint>
+#include <utility>
+#include <algorithm>
 #include <glad/glad.h>
 #include <cpputils/debug.hpp>
 #include <cpputils/types.hpp>
+#include <cpputils/error.hpp>
+
+#include "registry.hpp"
+#include "vbo.hpp"
 
 namespace GL {
 
 class VAO {
+    static constexpr u32 maxBindings = 16;
+
+    // Bind-to-modify fallback for the separate format/binding calls: the
+    // buffer side is remembered so attribFormat can emit glVertexAttribPointer
+    struct Binding {
+        u32 buffer;
+        i64 offset;
+        i32 stride;
+        u32 divisor;
+    };
+
     u32 m_id;
-    
+    Binding m_bindings[maxBindings] {};
+
 public:
     VAO();
     VAO(u32 id);
+
+    // Owns its name: moves hand it over, copies would delete it twice
+    VAO(const VAO&) = delete;
+    VAO& operator=(const VAO&) = delete;
+
+    inline VAO(VAO&& other) : m_id(std::exchange(other.m_id, 0)) {
+        std::copy(std::begin(other.m_bindings), std::end(other.m_bindings), m_bindings);
+    }
+
+    inline VAO& operator=(VAO&& other) {
+        std::swap(m_id, other.m_id);
+        std::swap(m_bindings, other.m_bindings);
+        return *this;
+    }
+
     VAO& use();
     VAO& unuse();
+
+    // Vertex buffer binding point: buffer, start offset and stride in bytes.
+    // divisor 0 advances per vertex, N per N instances.
+    VAO& vertexBuffer(u32 binding, u32 buffer, i64 offset, i32 stride, u32 divisor = 0);
+    template<typename T, typename... Ts>
+    VAO& vertexBuffer(u32 binding, VBO<T, Ts...>& vbo, u32 divisor = 0);
+    // Layout of one attribute inside the records of a binding point; enables it.
+    // Set the binding's buffer first, the fallback reads it here.
+    VAO& attribFormat(u32 location, i32 size, u32 type, bool normalized, u32 relativeOffset, u32 binding);
+    VAO& elementBuffer(u32 buffer);
+    u32 id() const;
     ~VAO();
 };
 
 inline VAO::VAO() {
-    glGenVertexArrays(1, &m_id);
+    m_id = genName(ResourceKind::VertexArray);
     logDebug("Created vao: %d", m_id);
 }
 
@@ -36,8 +80,62 @@ inline VAO& VAO::unuse() {
     return *this;
 }
 
+inline VAO& VAO::vertexBuffer(u32 binding, u32 buffer, i64 offset, i32 stride, u32 divisor) {
+    if (binding >= maxBindings) {
+        abort("VAO binding point out of range");
+    }
+    if (dsa_enabled) {
+        glVertexArrayVertexBuffer(m_id, binding, buffer, offset, stride);
+        glVertexArrayBindingDivisor(m_id, binding, divisor);
+        return *this;
+    }
+    // Attributes already pointing at this binding keep their old buffer until
+    // attribFormat is called again, as with glVertexAttribPointer
+    m_bindings[binding] = {buffer, offset, stride, divisor};
+    return *this;
+}
+
+template<typename T, typename... Ts>
+inline VAO& VAO::vertexBuffer(u32 binding, VBO<T, Ts...>& vbo, u32 divisor) {
+    return vertexBuffer(binding, vbo.id(), 0, sizeof(typename VBO<T, Ts...>::type), divisor);
+}
+
+inline VAO& VAO::attribFormat(u32 location, i32 size, u32 type, bool normalized, u32 relativeOffset, u32 binding) {
+    if (binding >= maxBindings) {
+        abort("VAO binding point out of range");
+    }
+    if (dsa_enabled) {
+        glVertexArrayAttribFormat(m_id, location, size, type, normalized, relativeOffset);
+        glVertexArrayAttribBinding(m_id, location, binding);
+        glEnableVertexArrayAttrib(m_id, location);
+        return *this;
+    }
+    const Binding& b = m_bindings[binding];
+    use();
+    glBindBuffer(GL_ARRAY_BUFFER, b.buffer);
+    glVertexAttribPointer(location, size, type, normalized, b.stride, reinterpret_cast<const void*>(b.offset + relativeOffset));
+    glVertexAttribDivisor(location, b.divisor);
+    glEnableVertexAttribArray(location);
+    return *this;
+}
+
+inline VAO& VAO::elementBuffer(u32 buffer) {
+    if (dsa_enabled) {
+        glVertexArrayElementBuffer(m_id, buffer);
+        return *this;
+    }
+    use();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    return *this;
+}
+
+inline u32 VAO::id() const {
+    return m_id;
+}
+
 inline VAO::~VAO() {
-    glDeleteVertexArrays(1, &m_id);
+    if (!m_id) return;
+    deleteName(ResourceKind::VertexArray, m_id);
     logDebug("Destroyed vao: %d", m_id);
 }
 
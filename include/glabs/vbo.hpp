@@ -1,4 +1,5 @@
 #pragma once
+#include <utility>
 #include <glad/glad.h>
 #include <cpputils/types.hpp>
 #include <cpputils/debug.hpp>
@@ -6,30 +7,59 @@
 #include <cpputils/tuple.hpp>
 #include <cpputils/metafunctions.hpp>
 
+#include "registry.hpp"
+#include "memory.hpp"
+
 namespace GL {
 
 template<typename T, typename... Ts>
 class VBO {
     u32 m_id;
 
+    // Under DSA the buffer is edited by name; otherwise it must be bound
+    inline void storage(u64 size, const void* data, u32 draw_type) {
+        if (dsa_enabled) glNamedBufferData(m_id, size, data, draw_type);
+        else glBufferData(GL_ARRAY_BUFFER, size, data, draw_type);
+        trackMemory(ResourceKind::Buffer, m_id, MemoryCategory::Vertex, size);
+    }
+
+    inline void update(u64 offset, u64 size, const void* data) {
+        if (dsa_enabled) glNamedBufferSubData(m_id, offset, size, data);
+        else glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    }
+
 public:
     using type = Conditional<(sizeof...(Ts)>0), Tuple<T, Ts...>, T>;
     static constexpr std::size_t ntypes = 1+sizeof...(Ts);
     
     inline VBO() {
-        glGenBuffers(1, &m_id);
+        m_id = genName(ResourceKind::Buffer);
         logDebug("Created vbo: %d", m_id);
     }
 
     inline VBO(std::initializer_list<type> l, u32 draw_type = GL_STATIC_DRAW) {
-        glGenBuffers(1, &m_id);
+        m_id = genName(ResourceKind::Buffer);
         logDebug("Created vbo: %d", m_id);
-        use();
+        if (!dsa_enabled) use();
         bufferData(l, draw_type);
     }
 
+    // Owns its name: moves hand it over, copies would delete it twice
+    VBO(const VBO&) = delete;
+    VBO& operator=(const VBO&) = delete;
+
+    inline VBO(VBO&& other) : m_id(std::exchange(other.m_id, 0)) {
+
+    }
+
+    inline VBO& operator=(VBO&& other) {
+        std::swap(m_id, other.m_id);
+        return *this;
+    }
+
     inline auto& use() {
         glBindBuffer(GL_ARRAY_BUFFER, m_id);
+        touchMemory(ResourceKind::Buffer, m_id);
         return *this;
     }
     inline auto& unuse() {
@@ -40,27 +70,28 @@ public:
     template<typename T2>
     requires requires(T2 t) { t.data(); t.size(); }
     inline auto& bufferData(T2& data, u32 draw_type) {
-        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(type), data.data(), draw_type);
+        storage(data.size() * sizeof(type), data.data(), draw_type);
         return *this;
     }
 
     inline auto& bufferData(std::initializer_list<type> data, u32 draw_type) {
-        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(type), (void*)data.begin(), draw_type);
+        storage(data.size() * sizeof(type), data.begin(), draw_type);
         return *this;
     }
 
     inline auto& bufferData(T* data, u32 size, u32 draw_type) {
-        glBufferData(GL_ARRAY_BUFFER, size, (void*)data, draw_type);
+        storage(size, data, draw_type);
         return *this;
     }
 
     inline auto& bufferSubData(Vector<type>& data, u32 offset, u32 size) {
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data.data());
+        update(offset, size, data.data());
         return *this;
     }
 
     inline auto& bufferSubData(T&& data, u32 offset) {
-        glBufferSubData(GL_ARRAY_BUFFER, offset*sizeof(type), sizeof(type), &data);
+        update(offset*sizeof(type), sizeof(type), &data);
+        return *this;
     }
 
     // template<std::size_t... s>
@@ -74,20 +105,117 @@ public:
     inline auto& bufferSubData(T2&& data, u32 offset) {
         using T2_noref = RemoveReference<T2>;
     //    logDebug("bufferSubData offset: %d, size %d", offset*sizeof(type)+tuple_offset<T2_noref, type>(), sizeof(T2_noref));
-        glBufferSubData(GL_ARRAY_BUFFER, offset*sizeof(type)+tupleOffset<T2_noref, type>(), sizeof(T2_noref), &data);
+        update(offset*sizeof(type)+tupleOffset<T2_noref, type>(), sizeof(T2_noref), &data);
         return *this;
 
     }
     
     inline auto& bufferSubData(T* data, u32 size, u32 offset) {
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+        update(offset, size, data);
         return *this;
     }
 
+    inline u32 id() const {
+        return m_id;
+    }
+
     inline ~VBO() {
-        glDeleteBuffers(1, &m_id);
+        if (!m_id) return;
+        untrackMemory(ResourceKind::Buffer, m_id);
+        deleteName(ResourceKind::Buffer, m_id);
         logDebug("Destroyed vbo: %d", m_id);
     }
 };
 
+// Structure-of-arrays layout: each tuple element gets its own buffer, so a
+// hot attribute can be restreamed without touching the cold ones. Unlike
+// VBO, uploads bind the target stream themselves (or skip the bind under DSA).
+template<typename... Ts>
+class SoAVBO {
+    u32 m_ids[sizeof...(Ts)];
+
+public:
+    using type = Tuple<Ts...>;
+    static constexpr std::size_t ntypes = sizeof...(Ts);
+
+    template<u32 I>
+    using element = TupleElement<I, type>;
+
+    inline SoAVBO() {
+        for (auto& id : m_ids) id = genName(ResourceKind::Buffer);
+        logDebug("Created soa vbo: %d..%d", m_ids[0], m_ids[ntypes-1]);
+    }
+
+    SoAVBO(const SoAVBO&) = delete;
+    SoAVBO& operator=(const SoAVBO&) = delete;
+
+    inline SoAVBO(SoAVBO&& other) {
+        for (u32 i {}; i < ntypes; i++) m_ids[i] = std::exchange(other.m_ids[i], 0);
+    }
+
+    inline SoAVBO& operator=(SoAVBO&& other) {
+        std::swap(m_ids, other.m_ids);
+        return *this;
+    }
+
+    template<u32 I>
+    inline auto& use() {
+        glBindBuffer(GL_ARRAY_BUFFER, m_ids[I]);
+        touchMemory(ResourceKind::Buffer, m_ids[I]);
+        return *this;
+    }
+    inline auto& unuse() {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return *this;
+    }
+
+    template<u32 I, typename T2>
+    requires requires(T2 t) { t.data(); t.size(); }
+    inline auto& bufferData(T2& data, u32 draw_type) {
+        return bufferData<I>(data.data(), data.size(), draw_type);
+    }
+
+    template<u32 I>
+    inline auto& bufferData(const element<I>* data, u32 count, u32 draw_type) {
+        if (dsa_enabled) {
+            glNamedBufferData(m_ids[I], count * sizeof(element<I>), data, draw_type);
+        } else {
+            use<I>();
+            glBufferData(GL_ARRAY_BUFFER, count * sizeof(element<I>), data, draw_type);
+        }
+        trackMemory(ResourceKind::Buffer, m_ids[I], MemoryCategory::Vertex, count * sizeof(element<I>));
+        return *this;
+    }
+
+    // offset and count are in elements
+    template<u32 I>
+    inline auto& bufferSubData(const element<I>* data, u32 count, u32 offset) {
+        if (dsa_enabled) {
+            glNamedBufferSubData(m_ids[I], offset * sizeof(element<I>), count * sizeof(element<I>), data);
+        } else {
+            use<I>();
+            glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(element<I>), count * sizeof(element<I>), data);
+        }
+        return *this;
+    }
+
+    template<u32 I>
+    inline u32 id() const {
+        return m_ids[I];
+    }
+
+    inline const u32* ids() const {
+        return m_ids;
+    }
+
+    inline ~SoAVBO() {
+        if (!m_ids[0]) return;
+        for (auto id : m_ids) {
+            untrackMemory(ResourceKind::Buffer, id);
+            deleteName(ResourceKind::Buffer, id);
+        }
+        logDebug("Destroyed soa vbo: %d..%d", m_ids[0], m_ids[ntypes-1]);
+    }
+};
+
 };
@@ -0,0 +1,136 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <cpputils/debug.hpp>
+#include <cpputils/error.hpp>
+
+#include "threadpool.hpp"
+
+namespace GL {
+
+// Platform hooks for one context created in the render context's share
+// group. bind runs on the worker thread before any job, unbind when the pool
+// shuts down.
+struct SharedContext {
+    std::function<bool()> bind;
+    std::function<void()> unbind;
+};
+
+// Runs resource creation (buffers, textures, shader programs) on worker
+// threads that each own a shared context. Every job is followed by a fence;
+// the render thread picks up finished results in poll() only once their fence
+// has signaled, so it never blocks on a worker.
+//
+// Container objects (VAO, FBO) are not shared between contexts: create them in
+// the ready callback, which runs on the render thread. Resources destroyed on
+// a worker should go through a ResourceRegistry so deletion happens on the
+// render context.
+class ContextWorkers {
+    struct Finished {
+        GLsync fence;
+        std::function<void()> ready;
+    };
+
+    std::vector<SharedContext> m_contexts;
+    std::mutex m_mutex;
+    std::deque<Finished> m_finished;
+    u32 m_inFlight {};
+    std::unique_ptr<ThreadPool> m_pool;
+
+    inline void finish(std::function<void()> ready) {
+        // The flush makes sure the fence reaches the GPU even if this worker
+        // idles afterwards
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        std::lock_guard lock(m_mutex);
+        m_finished.push_back({fence, std::move(ready)});
+    }
+
+public:
+    inline ContextWorkers(std::vector<SharedContext> contexts) : m_contexts(std::move(contexts)) {
+        m_pool = std::make_unique<ThreadPool>(
+            m_contexts.size(),
+            [this](u32 i) {
+                // Jobs would otherwise run GL calls with no current context
+                if (!m_contexts[i].bind()) abort("ContextWorkers: could not bind a shared context");
+            },
+            [this](u32 i) {
+                if (m_contexts[i].unbind) m_contexts[i].unbind();
+            }
+        );
+    }
+
+    ContextWorkers(const ContextWorkers&) = delete;
+    ContextWorkers& operator=(const ContextWorkers&) = delete;
+
+    inline ~ContextWorkers() {
+        m_pool.reset();
+        for (auto& f : m_finished) glDeleteSync(f.fence);
+    }
+
+    // job() runs on a worker and returns the created resource; ready(result)
+    // runs on the render thread from poll() once the GPU has finished it
+    template<typename Job, typename Ready>
+    inline void submit(Job&& job, Ready&& ready) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_inFlight++;
+        }
+        m_pool->submit([this, job = std::forward<Job>(job), ready = std::forward<Ready>(ready)]() mutable {
+            using Result = decltype(job());
+            if constexpr (std::is_void_v<Result>) {
+                job();
+                finish(std::move(ready));
+            } else {
+                auto result = std::make_shared<Result>(job());
+                finish([ready = std::move(ready), result]() mutable {
+                    ready(std::move(*result));
+                });
+            }
+        });
+    }
+
+    // Fire and forget; a result, if any, is dropped on the render thread
+    template<typename Job>
+    inline void submit(Job&& job) {
+        submit(std::forward<Job>(job), [](auto&&...) {});
+    }
+
+    // Render thread: delivers the results whose fence has signaled, in
+    // submission order. Returns the number delivered.
+    inline u32 poll() {
+        u32 delivered {};
+        for (;;) {
+            Finished f;
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_finished.empty()) break;
+                GLenum status = glClientWaitSync(m_finished.front().fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+                f = std::move(m_finished.front());
+                m_finished.pop_front();
+                m_inFlight--;
+            }
+            glDeleteSync(f.fence);
+            f.ready();
+            delivered++;
+        }
+        return delivered;
+    }
+
+    inline u32 inFlight() {
+        std::lock_guard lock(m_mutex);
+        return m_inFlight;
+    }
+
+    inline u32 size() const {
+        return m_contexts.size();
+    }
+};
+
+};
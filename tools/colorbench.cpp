@@ -0,0 +1,210 @@
+// glabs_colorbench: checks every batch color kernel in colorbatch.hpp
+// bit-for-bit against the scalar references, then reports throughput per
+// SIMD level. Exits non-zero on the first mismatching kernel.
+//
+//   glabs_colorbench [--count N] [--reps N] [--seed N]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cpputils/types.hpp>
+#include <glabs/colorbatch.hpp>
+
+namespace {
+
+struct Options {
+    u32 count {1 << 20};
+    u32 reps {20};
+    u32 seed {1};
+};
+
+void usage() {
+    std::fprintf(stderr, "usage: glabs_colorbench [--count N] [--reps N] [--seed N]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!std::strcmp(a, "--count") && more) o.count = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--reps") && more) o.reps = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--seed") && more) o.seed = std::atoi(argv[++i]);
+        else return false;
+    }
+    return true;
+}
+
+const char* levelName(GL::SimdLevel level) {
+    switch (level) {
+    case GL::SimdLevel::Scalar: return "scalar";
+    case GL::SimdLevel::SSE2: return "sse2";
+    case GL::SimdLevel::AVX2: return "avx2";
+    }
+    return "?";
+}
+
+// Inputs shared by every kernel. Each batch starts with the exhaustive
+// cases (all 256 byte values, every sRGB threshold and its neighbours) and
+// is padded with random values, including out-of-range ones, to `count`.
+struct Inputs {
+    std::vector<GL::RGBA> bytes;
+    std::vector<float> floats;      // count * 4, RGBA quadruples
+    std::vector<float> h, s, v, a;
+
+    Inputs(u32 count, u32 seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<u32> byte(0, 255);
+        std::uniform_real_distribution<float> unit(-0.25f, 1.25f);
+        std::uniform_real_distribution<float> hue(-720.f, 720.f);
+        std::uniform_real_distribution<float> sv(0.f, 1.f);
+
+        for (u32 i {}; i < 256; i++) bytes.push_back(GL::RGBA(i, 255 - i, i ^ 0x5a, i));
+        while (bytes.size() < count) bytes.push_back(GL::RGBA(byte(rng), byte(rng), byte(rng), byte(rng)));
+
+        const float* threshold = GL::detail::srgbTables().threshold;
+        std::vector<float> edges {0.f, -0.f, 1.f, -1.f, 2.f, INFINITY, -INFINITY};
+        for (u32 k = 1; k < 256; k++) {
+            edges.push_back(threshold[k]);
+            edges.push_back(std::nextafter(threshold[k], -1.f));
+            edges.push_back(std::nextafter(threshold[k], 2.f));
+        }
+        for (u32 i {}; i < 256; i++) edges.push_back(i / 255.f);
+        floats = edges;
+        while (floats.size() % 4) floats.push_back(unit(rng));
+        while (floats.size() < u64(count) * 4) floats.push_back(unit(rng));
+        if (floats.size() > u64(count) * 4) count = floats.size() / 4;
+        bytes.resize(count, GL::RGBA(1, 2, 3, 4));
+
+        // Hue on every sector boundary, then random angles of either sign
+        for (i32 d = -720; d <= 720 && h.size() < count; d += 30) {
+            h.push_back(float(d));
+            s.push_back(1.f);
+            v.push_back(1.f);
+            a.push_back(1.f);
+        }
+        while (h.size() < count) {
+            h.push_back(hue(rng));
+            s.push_back(sv(rng));
+            v.push_back(sv(rng));
+            a.push_back(sv(rng));
+        }
+    }
+
+    u32 size() const { return bytes.size(); }
+};
+
+template<typename T>
+bool same(const std::vector<T>& ref, const std::vector<T>& out, const char* kernel, GL::SimdLevel level) {
+    if (!std::memcmp(ref.data(), out.data(), ref.size() * sizeof(T))) return true;
+    u64 bytes = ref.size() * sizeof(T);
+    auto* r = reinterpret_cast<const u8*>(ref.data());
+    auto* o = reinterpret_cast<const u8*>(out.data());
+    u64 at {};
+    while (at < bytes && r[at] == o[at]) at++;
+    std::printf("MISMATCH %s/%s at element %llu\n", kernel, levelName(level), (unsigned long long) (at / sizeof(T)));
+    return false;
+}
+
+// Runs every kernel at `level` and compares with the scalar kernels, which
+// call the per-element references (HSVA(), unormToU8(), the sRGB tables)
+bool checkExact(const Inputs& in, GL::SimdLevel level) {
+    GL::ColorKernels ref = GL::colorKernels(GL::SimdLevel::Scalar);
+    GL::ColorKernels k = GL::colorKernels(level);
+    u32 n = in.size();
+    bool ok = true;
+
+    std::vector<GL::RGBA> rgbaRef(n), rgbaOut(n);
+    std::vector<float> floatRef(u64(n) * 4), floatOut(u64(n) * 4);
+
+    ref.hsvaToRGBA(in.h.data(), in.s.data(), in.v.data(), in.a.data(), rgbaRef.data(), n);
+    k.hsvaToRGBA(in.h.data(), in.s.data(), in.v.data(), in.a.data(), rgbaOut.data(), n);
+    ok &= same(rgbaRef, rgbaOut, "hsvaToRGBA", level);
+
+    ref.rgbaToFloat4(in.bytes.data(), floatRef.data(), n);
+    k.rgbaToFloat4(in.bytes.data(), floatOut.data(), n);
+    ok &= same(floatRef, floatOut, "rgbaToFloat4", level);
+
+    ref.float4ToRGBA(in.floats.data(), rgbaRef.data(), n);
+    k.float4ToRGBA(in.floats.data(), rgbaOut.data(), n);
+    ok &= same(rgbaRef, rgbaOut, "float4ToRGBA", level);
+
+    ref.srgbToLinear(in.bytes.data(), floatRef.data(), n);
+    k.srgbToLinear(in.bytes.data(), floatOut.data(), n);
+    ok &= same(floatRef, floatOut, "srgbToLinear", level);
+
+    ref.linearToSrgb(in.floats.data(), rgbaRef.data(), n);
+    k.linearToSrgb(in.floats.data(), rgbaOut.data(), n);
+    ok &= same(rgbaRef, rgbaOut, "linearToSrgb", level);
+
+    // The tables must agree with the formulas they replace
+    for (u32 i {}; i < 256; i++) {
+        float x = i / 255.f;
+        if (GL::detail::srgbTables().decode[i] != GL::srgbDecode(x)) {
+            std::printf("MISMATCH srgbDecode table at %u\n", i);
+            ok = false;
+        }
+    }
+    for (u32 i {}; i < in.floats.size(); i++) {
+        float l = in.floats[i];
+        u32 expect = static_cast<u32>(GL::srgbEncode(std::min(std::max(l, 0.f), 1.f)) * 255.f + 0.5f);
+        if (GL::detail::linearToSrgbByte(GL::detail::srgbTables().threshold, l) != expect) {
+            std::printf("MISMATCH srgbEncode threshold search at %g\n", l);
+            ok = false;
+            break;
+        }
+    }
+    return ok;
+}
+
+template<typename F>
+double melementsPerSecond(u32 n, u32 reps, F&& run) {
+    run();
+    auto start = std::chrono::steady_clock::now();
+    for (u32 r {}; r < reps; r++) run();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return double(n) * reps / s / 1e6;
+}
+
+void bench(const Inputs& in, GL::SimdLevel level, u32 reps) {
+    GL::ColorKernels k = GL::colorKernels(level);
+    u32 n = in.size();
+    std::vector<GL::RGBA> rgba(n);
+    std::vector<float> floats(u64(n) * 4);
+    std::printf("%-8s %12.1f %12.1f %12.1f %12.1f %12.1f\n", levelName(k.level),
+        melementsPerSecond(n, reps, [&] { k.hsvaToRGBA(in.h.data(), in.s.data(), in.v.data(), in.a.data(), rgba.data(), n); }),
+        melementsPerSecond(n, reps, [&] { k.rgbaToFloat4(in.bytes.data(), floats.data(), n); }),
+        melementsPerSecond(n, reps, [&] { k.float4ToRGBA(in.floats.data(), rgba.data(), n); }),
+        melementsPerSecond(n, reps, [&] { k.srgbToLinear(in.bytes.data(), floats.data(), n); }),
+        melementsPerSecond(n, reps, [&] { k.linearToSrgb(in.floats.data(), rgba.data(), n); }));
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    Inputs inputs(options.count, options.seed);
+    std::printf("%u colors, best level %s\n", inputs.size(), levelName(GL::colorKernels().level));
+
+    // Levels the CPU lacks fall back to a lower one and are skipped
+    std::vector<GL::SimdLevel> levels;
+    for (auto level : {GL::SimdLevel::Scalar, GL::SimdLevel::SSE2, GL::SimdLevel::AVX2}) {
+        if (GL::colorKernels(level).level == level) levels.push_back(level);
+    }
+
+    bool ok = true;
+    for (auto level : levels) ok &= checkExact(inputs, level);
+    std::printf("exactness: %s\n\n", ok ? "all kernels match the scalar references" : "FAILED");
+
+    std::printf("%-8s %12s %12s %12s %12s %12s   (M colors/s)\n", "level", "hsva>rgba", "rgba>float4", "float4>rgba", "srgb>linear", "linear>srgb");
+    for (auto level : levels) bench(inputs, level, options.reps);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+// glabs_glyphbench: measures GL::GlyphAtlas on a headless EGL context with a
+// procedural glyph source: distance field throughput per thread count, then
+// atlas upload bytes per frame while text streams in.
+//
+//   glabs_glyphbench [--glyphs N] [--size PX] [--spread PX] [--atlas WxH]
+//                    [--threads N] [--per-frame N] [--frame-ms MS]
+//
+// Without --atlas the atlas is sized to hold every glyph, so the upload
+// figures aren't skewed by rejected glyphs.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <glabs/glyphs.hpp>
+
+namespace {
+
+struct Options {
+    u32 glyphs {2048};
+    u32 size {48};
+    u32 spread {6};
+    u32 width {};       // 0: sized from the glyph count
+    u32 height {};
+    u32 threads {std::max(std::thread::hardware_concurrency(), 1u)};
+    u32 perFrame {32};
+    u32 frameMs {16};
+};
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: glabs_glyphbench [--glyphs N] [--size PX] [--spread PX] [--atlas WxH]\n"
+        "                        [--threads N] [--per-frame N] [--frame-ms MS]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!std::strcmp(a, "--glyphs") && more) o.glyphs = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--size") && more) o.size = std::max(4, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--spread") && more) o.spread = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--threads") && more) o.threads = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--per-frame") && more) o.perFrame = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--frame-ms") && more) o.frameMs = std::max(0, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--atlas") && more) {
+            if (std::sscanf(argv[++i], "%ux%u", &o.width, &o.height) != 2) return false;
+        }
+        else return false;
+    }
+    return true;
+}
+
+// The atlas only renders offscreen, so no surface is needed
+bool createContext() {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    EGLDisplay display = getPlatformDisplay
+        ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+        : EGL_NO_DISPLAY;
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!eglInitialize(display, nullptr, nullptr)) return false;
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint contextAttribs[] {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, nullptr, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) return false;
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) return false;
+    return gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+}
+
+// Smallest power-of-two atlas, doubling width then height, whose area holds
+// every glyph's cell (proceduralGlyph's widest, plus padding and gutter) with
+// slack for packing
+void sizeAtlas(Options& o) {
+    u64 cellWidth = o.size * 55 / 64 + 2 * o.spread + 1;
+    u64 cellHeight = o.size * 3 / 4 + 2 * o.spread + 1;
+    u64 need = cellWidth * cellHeight * o.glyphs * 5 / 4;
+    o.width = o.height = 256;
+    while (u64(o.width) * o.height < need) {
+        if (o.width <= o.height) o.width *= 2;
+        else o.height *= 2;
+    }
+}
+
+// A ring and a slanted bar whose proportions vary per codepoint, with 4x4
+// supersampled coverage: curved and straight edges, no font needed
+bool proceduralGlyph(u32 codepoint, u32 size, GL::GlyphBitmap& g) {
+    u32 h = codepoint * 2654435761u;
+    g.width = size * (40 + (h & 15)) / 64;
+    g.height = size * 3 / 4;
+    g.left = size / 16;
+    g.top = g.height;
+    g.advance = g.width + size / 8.f;
+    g.coverage.assign(g.width * g.height, 0);
+
+    float cx = g.width * 0.5f;
+    float cy = g.height * 0.6f;
+    float outer = std::min(cx, g.height * 0.4f);
+    float inner = outer * (0.4f + ((h >> 4) & 7) / 32.f);
+    float slant = (((h >> 8) & 15) / 15.f - 0.5f) * 0.6f;
+    float bar = g.width * 0.08f + 1.f;
+    for (u32 y {}; y < g.height; y++) {
+        for (u32 x {}; x < g.width; x++) {
+            u32 hits {};
+            for (u32 s {}; s < 16; s++) {
+                float px = x + (s % 4 + 0.5f) / 4.f;
+                float py = y + (s / 4 + 0.5f) / 4.f;
+                float r = std::hypot(px - cx, py - cy);
+                bool ring = r <= outer && r >= inner;
+                bool stem = std::abs(px - (cx + outer * 0.7f) - (py - cy) * slant) <= bar;
+                hits += ring || stem;
+            }
+            g.coverage[y * g.width + x] = hits * 255 / 16;
+        }
+    }
+    return true;
+}
+
+double ms(u64 ns) {
+    return ns / 1e6;
+}
+
+void benchGeneration(const Options& o, u32 threads, const std::vector<u32>& codepoints) {
+    GL::ThreadPool pool(threads);
+    GL::GlyphAtlas atlas(proceduralGlyph, &pool, o.size, o.spread, o.width, o.height);
+    auto start = std::chrono::steady_clock::now();
+    atlas.request(codepoints).wait();
+    u64 wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    GL::GlyphStats s = atlas.stats();
+    std::printf("%8u %12.3f %14.0f %12.2f\n", threads, ms(wall), s.generated / (wall / 1e9), s.generateNs / 1e3 / std::max<u64>(s.generated, 1));
+}
+
+// Requests perFrame new glyphs a frame and uploads whatever finished, with
+// frames paced at frameMs like a render loop
+void benchUploads(const Options& o, const std::vector<u32>& codepoints) {
+    GL::ThreadPool pool(o.threads);
+    GL::GlyphAtlas atlas(proceduralGlyph, &pool, o.size, o.spread, o.width, o.height);
+    std::vector<u64> frames;
+    u32 next {};
+    auto frame = std::chrono::steady_clock::now();
+    for (;;) {
+        u32 count = std::min<u32>(o.perFrame, codepoints.size() - next);
+        atlas.request(std::span(codepoints).subspan(next, count));
+        next += count;
+        atlas.update();
+        GL::GlyphStats s = atlas.stats();
+        frames.push_back(s.frameUploadBytes);
+        if (next == codepoints.size() && s.generated == codepoints.size()) {
+            atlas.wait().update();
+            frames.push_back(atlas.stats().frameUploadBytes);
+            break;
+        }
+        frame += std::chrono::milliseconds(o.frameMs);
+        std::this_thread::sleep_until(frame);
+    }
+    glFinish();
+
+    GL::GlyphStats s = atlas.stats();
+    u32 busy {};
+    for (u64 f : frames) busy += f != 0;
+    std::sort(frames.begin(), frames.end());
+    std::printf("\nuploads: %zu frames, %u with uploads, %.1f KiB total\n", frames.size(), busy, s.uploadedBytes / 1024.0);
+    std::printf("bytes/frame: avg %.0f  p95 %llu  max %llu\n", double(s.uploadedBytes) / frames.size(),
+        (unsigned long long) frames[(frames.size() - 1) * 95 / 100], (unsigned long long) frames.back());
+    std::printf("atlas: %.1f%% occupied, %u rejected\n", atlas.occupancy() * 100.f, s.rejected);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    if (!options.width || !options.height) sizeAtlas(options);
+    if (!createContext()) {
+        std::fprintf(stderr, "glabs_glyphbench: could not create a headless GL context\n");
+        return 1;
+    }
+    std::printf("%u glyphs at %upx, spread %u, %ux%u atlas, %s\n", options.glyphs, options.size, options.spread, options.width, options.height, glGetString(GL_RENDERER));
+
+    std::vector<u32> codepoints(options.glyphs);
+    for (u32 i {}; i < options.glyphs; i++) codepoints[i] = 0x4e00 + i;
+
+    std::printf("%8s %12s %14s %12s\n", "threads", "wall ms", "glyphs/s", "us/glyph");
+    for (u32 t = 1; t < options.threads; t *= 2) benchGeneration(options, t, codepoints);
+    benchGeneration(options, options.threads, codepoints);
+
+    benchUploads(options, codepoints);
+    return 0;
+}
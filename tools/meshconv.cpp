@@ -0,0 +1,167 @@
+// glabs_meshconv: converts a Wavefront OBJ into a .glbm mesh whose vertex
+// records match VBO<...> of the chosen layout.
+//
+//   glabs_meshconv <in.obj> <out.glbm> [p3 | p3n3 | p3t2 | p3n3t2]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cpputils/types.hpp>
+#include <cpputils/tuple.hpp>
+#include <cppmaths/vec.hpp>
+#include <glabs/meshformat.hpp>
+#include <glabs/hash.hpp>
+
+namespace {
+
+struct Corner {
+    i32 p, t, n;
+    bool operator==(const Corner&) const = default;
+};
+
+struct CornerHash {
+    std::size_t operator()(const Corner& c) const {
+        return GL::hash64(&c, sizeof(c));
+    }
+};
+
+struct Obj {
+    std::vector<Vec3> positions;
+    std::vector<Vec2> uvs;
+    std::vector<Vec3> normals;
+    std::vector<Corner> corners;    // Unique vertices
+    std::vector<u32> indices;
+};
+
+// OBJ indices are 1-based, negative ones count back from the end
+i32 resolve(long index, std::size_t count) {
+    if (index > 0) return static_cast<i32>(index - 1);
+    if (index < 0) return static_cast<i32>(count + index);
+    return -1;
+}
+
+bool parseObj(const char* path, Obj& obj) {
+    FILE* f = std::fopen(path, "r");
+    if (!f) return false;
+
+    std::unordered_map<Corner, u32, CornerHash> unique;
+    char line[1024];
+    while (std::fgets(line, sizeof(line), f)) {
+        if (line[0] == 'v' && line[1] == ' ') {
+            Vec3 p {};
+            std::sscanf(line + 2, "%f %f %f", &p.x, &p.y, &p.z);
+            obj.positions.push_back(p);
+        } else if (line[0] == 'v' && line[1] == 't') {
+            Vec2 t {};
+            std::sscanf(line + 3, "%f %f", &t.x, &t.y);
+            obj.uvs.push_back(t);
+        } else if (line[0] == 'v' && line[1] == 'n') {
+            Vec3 n {};
+            std::sscanf(line + 3, "%f %f %f", &n.x, &n.y, &n.z);
+            obj.normals.push_back(n);
+        } else if (line[0] == 'f' && line[1] == ' ') {
+            std::vector<u32> face;
+            char* s = line + 2;
+            while (*s) {
+                while (*s == ' ' || *s == '\t') s++;
+                if (!*s || *s == '\n' || *s == '\r') break;
+                Corner c {-1, -1, -1};
+                c.p = resolve(std::strtol(s, &s, 10), obj.positions.size());
+                if (*s == '/') {
+                    s++;
+                    if (*s != '/') c.t = resolve(std::strtol(s, &s, 10), obj.uvs.size());
+                    if (*s == '/') {
+                        s++;
+                        c.n = resolve(std::strtol(s, &s, 10), obj.normals.size());
+                    }
+                }
+                while (*s && *s != ' ' && *s != '\t' && *s != '\n') s++;
+
+                auto [it, inserted] = unique.try_emplace(c, obj.corners.size());
+                if (inserted) obj.corners.push_back(c);
+                face.push_back(it->second);
+            }
+            // Triangle fan
+            for (std::size_t i = 2; i < face.size(); i++) {
+                obj.indices.insert(obj.indices.end(), {face[0], face[i-1], face[i]});
+            }
+        }
+    }
+    std::fclose(f);
+    return true;
+}
+
+template<typename T>
+T fetch(const std::vector<T>& values, i32 index) {
+    return index >= 0 && static_cast<std::size_t>(index) < values.size() ? values[index] : T {};
+}
+
+// Element I of a record comes from the matching OBJ stream
+template<typename E>
+E attribute(const Obj& obj, const Corner& c, u32 slot);
+
+template<>
+Vec3 attribute<Vec3>(const Obj& obj, const Corner& c, u32 slot) {
+    return slot == 0 ? fetch(obj.positions, c.p) : fetch(obj.normals, c.n);
+}
+
+template<>
+Vec2 attribute<Vec2>(const Obj& obj, const Corner& c, u32) {
+    return fetch(obj.uvs, c.t);
+}
+
+template<typename Tupl>
+bool convert(const Obj& obj, const char* out) {
+    std::vector<u8> records(obj.corners.size() * sizeof(Tupl));
+    for (std::size_t v {}; v < obj.corners.size(); v++) {
+        u8* record = records.data() + v * sizeof(Tupl);
+        if constexpr (IsTuple<Tupl>) {
+            constexpr_for(u32 i=0, i<TupleSize<Tupl>, i+1,
+                using E = TupleElement<i, Tupl>;
+                E value = attribute<E>(obj, obj.corners[v], i);
+                std::memcpy(record + tupleOffset<i, Tupl>(), &value, sizeof(E));
+            );
+        } else {
+            Tupl value = attribute<Tupl>(obj, obj.corners[v], 0);
+            std::memcpy(record, &value, sizeof(Tupl));
+        }
+    }
+    return GL::writeMesh<Tupl>(out, records.data(), obj.corners.size(), obj.indices);
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <in.obj> <out.glbm> [p3 | p3n3 | p3t2 | p3n3t2]\n", argv[0]);
+        return 1;
+    }
+    std::string layout = argc > 3 ? argv[3] : "p3n3t2";
+
+    Obj obj;
+    if (!parseObj(argv[1], obj)) {
+        std::fprintf(stderr, "could not read %s\n", argv[1]);
+        return 1;
+    }
+
+    bool ok;
+    // Record types match VBO<...>::type, which is the bare element for one attribute
+    if (layout == "p3") ok = convert<Vec3>(obj, argv[2]);
+    else if (layout == "p3n3") ok = convert<Tuple<Vec3, Vec3>>(obj, argv[2]);
+    else if (layout == "p3t2") ok = convert<Tuple<Vec3, Vec2>>(obj, argv[2]);
+    else if (layout == "p3n3t2") ok = convert<Tuple<Vec3, Vec3, Vec2>>(obj, argv[2]);
+    else {
+        std::fprintf(stderr, "unknown layout %s\n", layout.c_str());
+        return 1;
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "could not write %s\n", argv[2]);
+        return 1;
+    }
+    std::printf("%s: %zu vertices, %zu indices (%s)\n", argv[2], obj.corners.size(), obj.indices.size(), layout.c_str());
+    return 0;
+}
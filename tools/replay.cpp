@@ -0,0 +1,154 @@
+// glabs_replay: re-executes a .glbt trace recorded with GL::GLCapture on a
+// headless EGL context and reports frame and per-call timings.
+//
+//   glabs_replay <trace.glbt> [--loops N] [--size WxH] [--top N]
+//                [--no-state] [--no-draws] [--no-uniforms] [--no-finish]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <glabs/trace.hpp>
+
+namespace {
+
+struct Options {
+    const char* path {};
+    u32 loops {1};
+    u32 width {1280};
+    u32 height {720};
+    u32 top {15};
+    GL::ReplayOptions replay;
+};
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: glabs_replay <trace.glbt> [--loops N] [--size WxH] [--top N]\n"
+        "                    [--no-state] [--no-draws] [--no-uniforms] [--no-finish]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!std::strcmp(a, "--loops") && more) o.loops = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--top") && more) o.top = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--size") && more) {
+            if (std::sscanf(argv[++i], "%ux%u", &o.width, &o.height) != 2) return false;
+        }
+        else if (!std::strcmp(a, "--no-state")) o.replay.skipState = true;
+        else if (!std::strcmp(a, "--no-draws")) o.replay.skipDraws = true;
+        else if (!std::strcmp(a, "--no-uniforms")) o.replay.skipUniforms = true;
+        else if (!std::strcmp(a, "--no-finish")) o.replay.finishFrames = false;
+        else if (a[0] == '-' || o.path) return false;
+        else o.path = a;
+    }
+    return o.path != nullptr;
+}
+
+// Renders into a pbuffer of the requested size when the platform has one,
+// otherwise without any default framebuffer
+bool createContext(u32 width, u32 height) {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    EGLDisplay display = getPlatformDisplay
+        ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+        : EGL_NO_DISPLAY;
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!eglInitialize(display, nullptr, nullptr)) return false;
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint configAttribs[] {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config {};
+    EGLint configs {};
+    eglChooseConfig(display, configAttribs, &config, 1, &configs);
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (configs) {
+        const EGLint pbufferAttribs[] {EGL_WIDTH, EGLint(width), EGL_HEIGHT, EGLint(height), EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+
+    // Traces recorded with the DSA backend need 4.5
+    EGLContext context = EGL_NO_CONTEXT;
+    for (EGLint minor : {5, 3}) {
+        const EGLint contextAttribs[] {
+            EGL_CONTEXT_MAJOR_VERSION, minor == 5 ? 4 : 3,
+            EGL_CONTEXT_MINOR_VERSION, minor,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, configs ? config : nullptr, EGL_NO_CONTEXT, contextAttribs);
+        if (context != EGL_NO_CONTEXT) break;
+    }
+    if (context == EGL_NO_CONTEXT) return false;
+    if (!eglMakeCurrent(display, surface, surface, context)) return false;
+    return gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+}
+
+double ms(u64 ns) {
+    return ns / 1e6;
+}
+
+void report(const GL::ReplayStats& stats, u32 top) {
+    std::vector<u64> frames = stats.frameNs;
+    if (!frames.empty()) {
+        std::sort(frames.begin(), frames.end());
+        u64 total {};
+        for (u64 f : frames) total += f;
+        std::printf("frames: %zu  min %.3f  avg %.3f  p95 %.3f  max %.3f ms\n",
+            frames.size(), ms(frames.front()), ms(total / frames.size()),
+            ms(frames[(frames.size() - 1) * 95 / 100]), ms(frames.back()));
+    }
+    std::printf("calls: %llu replayed, %llu skipped\n", (unsigned long long) stats.calls, (unsigned long long) stats.skipped);
+
+    std::vector<u32> ops;
+    for (u32 i {}; i < GL::traceOpCount; i++) {
+        if (stats.ops[i].calls) ops.push_back(i);
+    }
+    std::sort(ops.begin(), ops.end(), [&](u32 a, u32 b) { return stats.ops[a].ns > stats.ops[b].ns; });
+    if (ops.size() > top) ops.resize(top);
+    std::printf("%-32s %10s %12s %10s\n", "call", "count", "total ms", "ns/call");
+    for (u32 i : ops) {
+        const auto& op = stats.ops[i];
+        std::printf("%-32s %10llu %12.3f %10llu\n", GL::traceOpName[i], (unsigned long long) op.calls, ms(op.ns), (unsigned long long) (op.ns / op.calls));
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    if (!createContext(options.width, options.height)) {
+        std::fprintf(stderr, "glabs_replay: could not create a headless GL context\n");
+        return 1;
+    }
+
+    GL::GLReplay replay;
+    if (!replay.open(options.path)) {
+        std::fprintf(stderr, "glabs_replay: could not read %s\n", options.path);
+        return 1;
+    }
+    std::printf("%s: %llu calls, %u frames, %s\n", options.path, (unsigned long long) replay.calls(), replay.frames(), glGetString(GL_RENDERER));
+
+    for (u32 loop {}; loop < options.loops; loop++) {
+        if (options.loops > 1) std::printf("\nloop %u\n", loop + 1);
+        report(replay.run(options.replay), options.top);
+        replay.release();
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+// glabs_workercheck: exercises GL::ContextWorkers on a surfaceless EGL
+// context (e.g. Mesa llvmpipe). Workers create buffers, textures and programs
+// on shared contexts and return them by value; the render thread verifies
+// every result once its fence has signaled. Exits non-zero on any mismatch.
+//
+//   glabs_workercheck [--workers N] [--jobs N] [--kib N]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <cpputils/types.hpp>
+#include <glabs/egl.hpp>
+#include <glabs/vbo.hpp>
+#include <glabs/texture.hpp>
+#include <glabs/shader.hpp>
+
+namespace {
+
+struct Options {
+    u32 workers {2};
+    u32 jobs {64};
+    u32 kib {256};
+};
+
+void usage() {
+    std::fprintf(stderr, "usage: glabs_workercheck [--workers N] [--jobs N] [--kib N]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!std::strcmp(a, "--workers") && more) o.workers = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--jobs") && more) o.jobs = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(a, "--kib") && more) o.kib = std::max(1, std::atoi(argv[++i]));
+        else return false;
+    }
+    return true;
+}
+
+const EGLint contextAttribs[] {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+};
+
+// Render context with no surface; workers share with it
+bool createContext(EGLDisplay& display, EGLContext& context) {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    display = getPlatformDisplay
+        ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+        : EGL_NO_DISPLAY;
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!eglInitialize(display, nullptr, nullptr)) return false;
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint configAttribs[] {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config {};
+    EGLint configs {};
+    eglChooseConfig(display, configAttribs, &config, 1, &configs);
+    context = eglCreateContext(display, configs ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) return false;
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) return false;
+    return gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+}
+
+const char* vertexSource = R"(#version 330 core
+layout(location = 0) in vec3 position;
+void main() { gl_Position = vec4(position, 1.0); }
+)";
+
+const char* fragmentSource = R"(#version 330 core
+out vec4 color;
+void main() { color = vec4(1.0); }
+)";
+
+u32 pattern(u32 job, u32 i) {
+    return job * 2654435761u ^ i;
+}
+
+struct Results {
+    u32 buffers {};
+    u32 textures {};
+    u32 programs {};
+    u32 detached {};
+    u32 failures {};
+    u64 bytes {};
+
+    void fail(const char* what, u32 job) {
+        std::printf("FAIL %s (job %u)\n", what, job);
+        failures++;
+    }
+};
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    EGLDisplay display;
+    EGLContext context;
+    if (!createContext(display, context)) {
+        std::fprintf(stderr, "glabs_workercheck: could not create a headless GL context\n");
+        return 1;
+    }
+    std::printf("%u workers, %u jobs, %u KiB per upload, %s\n", options.workers, options.jobs, options.kib, glGetString(GL_RENDERER));
+
+    Results results;
+    u32 words = options.kib * 256;
+    u32 side = 1;
+    while (side * side < words) side *= 2;
+    auto start = std::chrono::steady_clock::now();
+    {
+        auto workers = GL::createEGLWorkers(display, context, options.workers, contextAttribs);
+
+        for (u32 job {}; job < options.jobs; job++) {
+            switch (job % 4) {
+            // Buffers come back by value: the move must keep the name alive
+            case 0:
+                workers->submit([job, words] {
+                    std::vector<u32> data(words);
+                    for (u32 i {}; i < words; i++) data[i] = pattern(job, i);
+                    GL::VBO<u32> vbo;
+                    if (!GL::dsa_enabled) vbo.use();
+                    vbo.bufferData(data, GL_STATIC_DRAW);
+                    return vbo;
+                }, [&results, job, words](GL::VBO<u32> vbo) {
+                    std::vector<u32> back(words);
+                    glBindBuffer(GL_ARRAY_BUFFER, vbo.id());
+                    glGetBufferSubData(GL_ARRAY_BUFFER, 0, words * sizeof(u32), back.data());
+                    glBindBuffer(GL_ARRAY_BUFFER, 0);
+                    for (u32 i {}; i < words; i++) {
+                        if (back[i] != pattern(job, i)) return results.fail("buffer contents", job);
+                    }
+                    results.buffers++;
+                    results.bytes += words * sizeof(u32);
+                });
+                break;
+            case 1:
+                workers->submit([job, side] {
+                    std::vector<u32> pixels(side * side);
+                    for (u32 i {}; i < pixels.size(); i++) pixels[i] = pattern(job, i);
+                    GL::Texture<GL_TEXTURE_2D> texture;
+                    texture.use();
+                    texture.setImage(GL_RGBA8, GL_RGBA, {i32(side), i32(side)}, pixels.data());
+                    texture.unuse();
+                    return texture;
+                }, [&results, job, side](GL::Texture<GL_TEXTURE_2D> texture) {
+                    std::vector<u32> back(side * side);
+                    texture.use();
+                    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, back.data());
+                    texture.unuse();
+                    for (u32 i {}; i < back.size(); i++) {
+                        if (back[i] != pattern(job, i)) return results.fail("texture contents", job);
+                    }
+                    results.textures++;
+                    results.bytes += back.size() * sizeof(u32);
+                });
+                break;
+            // Programs come back by value too
+            case 2:
+                workers->submit([] {
+                    GL::Shader shader(vertexSource, fragmentSource);
+                    shader.compile();
+                    return shader;
+                }, [&results, job](GL::Shader shader) {
+                    GLint linked {};
+                    glGetProgramiv(shader.getProgram(), GL_LINK_STATUS, &linked);
+                    if (!linked) return results.fail("program link status", job);
+                    results.programs++;
+                });
+                break;
+            // No ready callback: the result is dropped on the render thread
+            case 3:
+                workers->submit([words] {
+                    GL::VBO<u32> vbo;
+                    std::vector<u32> data(words);
+                    if (!GL::dsa_enabled) vbo.use();
+                    vbo.bufferData(data, GL_STREAM_DRAW);
+                    return vbo;
+                });
+                results.detached++;
+                break;
+            }
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (workers->inFlight()) {
+            workers->poll();
+            if (std::chrono::steady_clock::now() > deadline) {
+                results.fail("timed out waiting for workers", options.jobs);
+                break;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        std::printf("FAIL GL error 0x%x on the render context\n", error);
+        results.failures++;
+    }
+    std::printf("verified: %u buffers, %u textures, %u programs; %u detached jobs\n", results.buffers, results.textures, results.programs, results.detached);
+    std::printf("%.1f jobs/s, %.1f MiB verified\n", options.jobs / seconds, results.bytes / 1048576.0);
+    std::printf("%s\n", results.failures ? "FAILED" : "ok");
+    return results.failures ? 1 : 0;
+}